@@ -0,0 +1,384 @@
+#ifndef BOOST_GEOMETRY_PROJECTIONS_IMPL_APPROXIMATE_TRANSFORMER_HPP
+#define BOOST_GEOMETRY_PROJECTIONS_IMPL_APPROXIMATE_TRANSFORMER_HPP
+
+// Boost.Geometry - extensions-gis-projections (based on PROJ4)
+
+// Copyright (c) 2008-2015 Barend Gehrels, Amsterdam, the Netherlands.
+
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/geometry/extensions/gis/projections/impl/projects.hpp>
+
+namespace boost { namespace geometry { namespace projections
+{
+
+    // Transforms a raster of regularly spaced points approximately. The exact fwd
+    // (or inv) of the projection is evaluated at the corners of a coarse lattice
+    // of cells, at most max_cell points wide. A cell is split until the error of
+    // bilinear interpolation, checked at its centre and at the midpoints of its
+    // edges, is within the tolerance, and then its points are interpolated.
+    // The tolerance is in projected units (as returned by fwd): the inverse is
+    // checked by forwarding the interpolated points, once for an edge shared by
+    // two cells. The points of a cell are evaluated exactly if its checks cost
+    // as many evaluations, or if checks failing would make the count exceed the
+    // raster size by more than five evaluations per cell of the coarse lattice
+    // (the count never exceeds it by more). Points for which the projection
+    // fails are set to HUGE_VAL. Shared by all projections, it works with every
+    // projection class through its fwd and inv
+    template <typename Projection>
+    class approximate_transformer
+    {
+    public :
+        typedef typename Projection::geographic_type geographic_type;
+        typedef typename Projection::cartesian_type cartesian_type;
+
+        inline approximate_transformer(Projection const& prj, cartesian_type const& tolerance,
+                std::size_t max_cell = 64)
+            : m_prj(prj)
+            , m_tolerance(tolerance)
+            , m_max_cell(max_cell < 1 ? 1 : max_cell)
+            , m_u0(0), m_du(0), m_v0(0), m_dv(0), m_nu(0)
+            , m_a(0), m_b(0), m_size(0), m_unknown(0), m_allowance(0), m_count(0)
+        {}
+
+        // Forward of nlon x nlat points lon0 + i * dlon, lat0 + j * dlat, in radians, the
+        // longitudes relative to the central meridian, into raster_x and raster_y (per
+        // latitude a row of nlon). Returns the number of exact evaluations
+        inline std::size_t fwd_raster(geographic_type const& lon0, geographic_type const& dlon, std::size_t nlon,
+                geographic_type const& lat0, geographic_type const& dlat, std::size_t nlat,
+                cartesian_type* raster_x, cartesian_type* raster_y)
+        {
+            return transform(forward_tag(), lon0, dlon, nlon, lat0, dlat, nlat, raster_x, raster_y);
+        }
+
+        // Inverse of nx x ny points x0 + i * dx, y0 + j * dy into raster_lon and
+        // raster_lat (per y a row of nx). Returns the number of exact evaluations,
+        // of the inverse and of the forward checking it
+        inline std::size_t inv_raster(cartesian_type const& x0, cartesian_type const& dx, std::size_t nx,
+                cartesian_type const& y0, cartesian_type const& dy, std::size_t ny,
+                geographic_type* raster_lon, geographic_type* raster_lat)
+        {
+            return transform(inverse_tag(), x0, dx, nx, y0, dy, ny, raster_lon, raster_lat);
+        }
+
+    private :
+        // Both are the CalculationType of the projection
+        typedef cartesian_type coordinate_type;
+
+        struct forward_tag {};
+        struct inverse_tag {};
+
+        enum point_state { state_unknown, state_exact, state_failed, state_interpolated };
+
+        template <typename Tag>
+        inline std::size_t transform(Tag tag, coordinate_type const& u0, coordinate_type const& du, std::size_t nu,
+                coordinate_type const& v0, coordinate_type const& dv, std::size_t nv,
+                coordinate_type* a, coordinate_type* b)
+        {
+            m_u0 = u0; m_du = du; m_nu = nu;
+            m_v0 = v0; m_dv = dv;
+            m_a = a; m_b = b;
+            m_count = 0;
+            if (nu == 0 || nv == 0)
+            {
+                return m_count;
+            }
+            m_state.assign(nu * nv, state_unknown);
+            m_size = m_unknown = nu * nv;
+            m_allowance = 5 * ((nu + m_max_cell - 2) / m_max_cell)
+                * ((nv + m_max_cell - 2) / m_max_cell);
+            m_checked.clear();
+
+            // The coarse lattice, neighbouring cells share their corners
+            std::size_t j0 = 0;
+            do
+            {
+                std::size_t const j1 = (std::min)(j0 + m_max_cell, nv - 1);
+                std::size_t i0 = 0;
+                do
+                {
+                    std::size_t const i1 = (std::min)(i0 + m_max_cell, nu - 1);
+                    refine(tag, i0, i1, j0, j1);
+                    i0 = i1;
+                } while (i0 + 1 < nu);
+                j0 = j1;
+            } while (j0 + 1 < nv);
+            return m_count;
+        }
+
+        template <typename Tag>
+        inline void refine(Tag tag, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1)
+        {
+            bool const split_u = i1 - i0 > 1;
+            bool const split_v = j1 - j0 > 1;
+            std::size_t const im = (i0 + i1) / 2;
+            std::size_t const jm = (j0 + j1) / 2;
+            if ((split_u || split_v) && ! worth_checking(tag, i0, i1, j0, j1, im, jm))
+            {
+                for (std::size_t j = j0; j <= j1; j++)
+                {
+                    for (std::size_t i = i0; i <= i1; i++)
+                    {
+                        if (m_state[j * m_nu + i] == state_unknown)
+                        {
+                            evaluate(tag, i, j);
+                        }
+                    }
+                }
+                return;
+            }
+
+            bool valid = evaluate(tag, i0, j0);
+            valid = evaluate(tag, i1, j0) && valid;
+            valid = evaluate(tag, i0, j1) && valid;
+            valid = evaluate(tag, i1, j1) && valid;
+            if (! split_u && ! split_v)
+            {
+                // All points are corners
+                return;
+            }
+
+            if (valid
+                && within(tag, i0, i1, j0, j1, im, j0)
+                && within(tag, i0, i1, j0, j1, im, j1)
+                && within(tag, i0, i1, j0, j1, i0, jm)
+                && within(tag, i0, i1, j0, j1, i1, jm)
+                && within(tag, i0, i1, j0, j1, im, jm))
+            {
+                for (std::size_t j = j0; j <= j1; j++)
+                {
+                    for (std::size_t i = i0; i <= i1; i++)
+                    {
+                        std::size_t const index = j * m_nu + i;
+                        if (m_state[index] == state_unknown)
+                        {
+                            interpolate(i0, i1, j0, j1, i, j, m_a[index], m_b[index]);
+                            m_state[index] = state_interpolated;
+                            m_unknown--;
+                        }
+                    }
+                }
+                return;
+            }
+
+            if (split_u && split_v)
+            {
+                refine(tag, i0, im, j0, jm);
+                refine(tag, im, i1, j0, jm);
+                refine(tag, i0, im, jm, j1);
+                refine(tag, im, i1, jm, j1);
+            }
+            else if (split_u)
+            {
+                refine(tag, i0, im, j0, j1);
+                refine(tag, im, i1, j0, j1);
+            }
+            else
+            {
+                refine(tag, i0, i1, j0, jm);
+                refine(tag, i0, i1, jm, j1);
+            }
+        }
+
+        // Returns false if the points of a cell should rather be evaluated exactly:
+        // if its checks cost as many evaluations as its points not yet evaluated,
+        // or if, should they fail, the evaluations would exceed those of an exact
+        // raster by more than the allowance
+        template <typename Tag>
+        inline bool worth_checking(Tag tag, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t im, std::size_t jm) const
+        {
+            std::size_t const check_i[5] = { im, im, i0, i1, im };
+            std::size_t const check_j[5] = { j0, j1, jm, jm, jm };
+            std::size_t cost = 0;
+            for (std::size_t k = 0; k < 5; k++)
+            {
+                bool repeated = corner(i0, i1, j0, j1, check_i[k], check_j[k]);
+                for (std::size_t l = 0; l < k; l++)
+                {
+                    repeated = repeated || (check_i[l] == check_i[k] && check_j[l] == check_j[k]);
+                }
+                if (! repeated && ! checked(tag, i0, i1, j0, j1, check_i[k], check_j[k]))
+                {
+                    cost++;
+                }
+            }
+
+            std::size_t unknown = 0, reevaluated = 0;
+            for (std::size_t j = j0; j <= j1; j++)
+            {
+                for (std::size_t i = i0; i <= i1; i++)
+                {
+                    point_state const state = m_state[j * m_nu + i];
+                    if (! corner(i0, i1, j0, j1, i, j))
+                    {
+                        unknown += state == state_unknown ? 1 : 0;
+                    }
+                    else
+                    {
+                        reevaluated += state == state_interpolated ? 1 : 0;
+                    }
+                }
+            }
+            return cost < unknown
+                && m_count + reevaluated + cost + m_unknown <= m_size + m_allowance;
+        }
+
+        static inline bool corner(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t i, std::size_t j)
+        {
+            return (i == i0 || i == i1) && (j == j0 || j == j1);
+        }
+
+        // Returns true if checking a point costs no evaluation: for the forward, if the point
+        // is already evaluated, for the inverse, if the check of its edge is cached
+        inline bool checked(forward_tag, std::size_t, std::size_t, std::size_t, std::size_t,
+                std::size_t i, std::size_t j) const
+        {
+            point_state const state = m_state[j * m_nu + i];
+            return state == state_exact || state == state_failed;
+        }
+
+        inline bool checked(inverse_tag, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t i, std::size_t j) const
+        {
+            std::pair<std::size_t, std::size_t> const key = check_key(i0, i1, j0, j1, i, j);
+            return key.second > 0 && m_checked.count(key) > 0;
+        }
+
+        // Returns the key of the check of the midpoint of an edge, which is the same for
+        // both cells sharing that edge, or a key with 0 for the centre
+        inline std::pair<std::size_t, std::size_t> check_key(std::size_t i0, std::size_t i1,
+                std::size_t j0, std::size_t j1, std::size_t i, std::size_t j) const
+        {
+            std::size_t const index = j * m_nu + i;
+            return j == j0 || j == j1 ? std::make_pair(index, 2 * (i1 - i0))
+                : i == i0 || i == i1 ? std::make_pair(index, 2 * (j1 - j0) + 1)
+                : std::make_pair(index, std::size_t(0));
+        }
+
+        // Evaluates a point exactly, if not yet done, and returns true if the projection succeeded
+        template <typename Tag>
+        inline bool evaluate(Tag tag, std::size_t i, std::size_t j)
+        {
+            std::size_t const index = j * m_nu + i;
+            if (m_state[index] == state_unknown || m_state[index] == state_interpolated)
+            {
+                if (m_state[index] == state_unknown)
+                {
+                    m_unknown--;
+                }
+                m_state[index] = exact(tag, m_u0 + coordinate_type(i) * m_du, m_v0 + coordinate_type(j) * m_dv,
+                    m_a[index], m_b[index]) ? state_exact : state_failed;
+            }
+            return m_state[index] == state_exact;
+        }
+
+        inline bool exact(forward_tag, coordinate_type lp_lon, coordinate_type lp_lat,
+                coordinate_type& xy_x, coordinate_type& xy_y)
+        {
+            m_count++;
+            try
+            {
+                m_prj.fwd(lp_lon, lp_lat, xy_x, xy_y);
+                return true;
+            }
+            catch (proj_exception const&)
+            {
+                xy_x = xy_y = HUGE_VAL;
+                return false;
+            }
+        }
+
+        inline bool exact(inverse_tag, coordinate_type xy_x, coordinate_type xy_y,
+                coordinate_type& lp_lon, coordinate_type& lp_lat)
+        {
+            m_count++;
+            try
+            {
+                m_prj.inv(xy_x, xy_y, lp_lon, lp_lat);
+                return true;
+            }
+            catch (proj_exception const&)
+            {
+                lp_lon = lp_lat = HUGE_VAL;
+                return false;
+            }
+        }
+
+        // Returns true if the interpolation at a check point of a cell is within the tolerance
+        inline bool within(forward_tag tag, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t i, std::size_t j)
+        {
+            if (! evaluate(tag, i, j))
+            {
+                return false;
+            }
+            coordinate_type xy_x, xy_y;
+            interpolate(i0, i1, j0, j1, i, j, xy_x, xy_y);
+            std::size_t const index = j * m_nu + i;
+            return fabs(xy_x - m_a[index]) <= m_tolerance
+                && fabs(xy_y - m_b[index]) <= m_tolerance;
+        }
+
+        inline bool within(inverse_tag tag, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t i, std::size_t j)
+        {
+            if (corner(i0, i1, j0, j1, i, j))
+            {
+                return true;
+            }
+            std::pair<std::size_t, std::size_t> const key = check_key(i0, i1, j0, j1, i, j);
+            if (checked(tag, i0, i1, j0, j1, i, j))
+            {
+                return m_checked.find(key)->second;
+            }
+            coordinate_type lp_lon, lp_lat, xy_x, xy_y;
+            interpolate(i0, i1, j0, j1, i, j, lp_lon, lp_lat);
+            bool const result = exact(forward_tag(), lp_lon, lp_lat, xy_x, xy_y)
+                && fabs(xy_x - (m_u0 + coordinate_type(i) * m_du)) <= m_tolerance
+                && fabs(xy_y - (m_v0 + coordinate_type(j) * m_dv)) <= m_tolerance;
+            if (key.second > 0)
+            {
+                m_checked[key] = result;
+            }
+            return result;
+        }
+
+        // Interpolates a point bilinearly between the corners of a cell
+        inline void interpolate(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                std::size_t i, std::size_t j, coordinate_type& a, coordinate_type& b) const
+        {
+            coordinate_type const s = i1 > i0 ? coordinate_type(i - i0) / coordinate_type(i1 - i0) : coordinate_type(0);
+            coordinate_type const t = j1 > j0 ? coordinate_type(j - j0) / coordinate_type(j1 - j0) : coordinate_type(0);
+            std::size_t const c00 = j0 * m_nu + i0, c10 = j0 * m_nu + i1;
+            std::size_t const c01 = j1 * m_nu + i0, c11 = j1 * m_nu + i1;
+            a = (1 - t) * ((1 - s) * m_a[c00] + s * m_a[c10]) + t * ((1 - s) * m_a[c01] + s * m_a[c11]);
+            b = (1 - t) * ((1 - s) * m_b[c00] + s * m_b[c10]) + t * ((1 - s) * m_b[c01] + s * m_b[c11]);
+        }
+
+        Projection const& m_prj;
+        coordinate_type m_tolerance;
+        std::size_t m_max_cell;
+        coordinate_type m_u0, m_du, m_v0, m_dv;
+        std::size_t m_nu;
+        coordinate_type* m_a;
+        coordinate_type* m_b;
+        std::vector<point_state> m_state;
+        std::size_t m_size, m_unknown, m_allowance;
+        std::map<std::pair<std::size_t, std::size_t>, bool> m_checked;
+        std::size_t m_count;
+    };
+
+}}} // namespace boost::geometry::projections
+
+#endif // BOOST_GEOMETRY_PROJECTIONS_IMPL_APPROXIMATE_TRANSFORMER_HPP
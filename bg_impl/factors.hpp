@@ -0,0 +1,163 @@
+#ifndef BOOST_GEOMETRY_PROJECTIONS_IMPL_FACTORS_HPP
+#define BOOST_GEOMETRY_PROJECTIONS_IMPL_FACTORS_HPP
+
+// Boost.Geometry - extensions-gis-projections (based on PROJ4)
+
+// Copyright (c) 2008-2015 Barend Gehrels, Amsterdam, the Netherlands.
+
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The scale factors (FACTORS of Proj4), and their numeric calculation from
+// forward (pj_factors and pj_deriv of Proj4), shared by all projections
+
+#include <cmath>
+
+#include <boost/geometry/util/math.hpp>
+#include <boost/math/special_functions/hypot.hpp>
+
+namespace boost { namespace geometry { namespace projections
+{
+
+    #ifndef DOXYGEN_NO_DETAIL
+    namespace detail
+    {
+
+        // Flags of factors::code, telling which factors are calculated analytically
+        enum factors_code { analytic_xl_yl = 1, analytic_xp_yp = 2, analytic_hk = 4, analytic_conv = 8, analytic_thetap = 16 };
+
+        // Scale factors at a point: partial derivatives of x/y to lambda/phi,
+        // meridional (h), parallel (k) and areal (s) scale, angular distortion
+        // (omega), meridian-parallel angle (thetap), meridian convergence (conv)
+        // and the semi axes of the Tissot indicatrix (a, b)
+        template <typename T>
+        struct factors
+        {
+            T x_l, x_p, y_l, y_p;
+            T h, k, s, omega, thetap, conv, a, b;
+            int code;
+
+            factors()
+                : x_l(0), x_p(0), y_l(0), y_p(0)
+                , h(0), k(0), s(0), omega(0), thetap(0), conv(0), a(0), b(0)
+                , code(0)
+            {}
+        };
+
+        // Step of the numeric derivatives, in radians
+        template <typename T>
+        inline T factors_step() { return T(1.0e-5); }
+
+        // Moves the latitude away from the poles, where there are no derivatives
+        template <typename T>
+        inline T factors_latitude(T const& lat, T const& h)
+        {
+            T const limit = geometry::math::half_pi<T>() - h;
+            return lat > limit ? limit : lat < -limit ? -limit : lat;
+        }
+
+        template <typename T>
+        inline T factors_asin(T const& v)
+        {
+            return v >= T(1) ? geometry::math::half_pi<T>()
+                : v <= T(-1) ? -geometry::math::half_pi<T>()
+                : asin(v);
+        }
+
+        template <typename Projection, typename T>
+        inline void factors_forward(Projection const& prj, T lp_lon, T lp_lat, T& xy_x, T& xy_y)
+        {
+            prj.fwd(lp_lon, lp_lat, xy_x, xy_y);
+        }
+
+        // Completes the factors not calculated analytically. The derivatives are
+        // taken from four forward calls around the point, the other factors from
+        // the derivatives. If h, k and thetap are analytic (conics: lcc, eqdc),
+        // s, omega, a and b follow from them, and the derivatives are skipped if
+        // conv is analytic too (lcc, leaving x_l, x_p, y_l, y_p zero), or taken
+        // for conv from two forward calls along the parallel (eqdc). Projections
+        // without analytic h and k (without spc) pay four forward calls
+        template <typename Projection, typename T>
+        inline void complete_factors(Projection const& prj, T const& lp_lon, T const& lp_lat,
+                T const& h, T const& es, T const& one_es, factors<T>& fac)
+        {
+            bool const shape = (fac.code & (analytic_hk | analytic_thetap)) == (analytic_hk | analytic_thetap);
+            if (shape)
+            {
+                if (! (fac.code & (analytic_conv | analytic_xl_yl)))
+                {
+                    T x1, y1, x2, y2;
+                    factors_forward(prj, lp_lon + h, lp_lat, x1, y1);
+                    factors_forward(prj, lp_lon - h, lp_lat, x2, y2);
+                    fac.x_l = (x1 - x2) / (T(2) * h);
+                    fac.y_l = (y1 - y2) / (T(2) * h);
+                }
+            }
+            else if ((fac.code & (analytic_xl_yl | analytic_xp_yp)) != (analytic_xl_yl | analytic_xp_yp))
+            {
+                T x1, y1, x2, y2, x3, y3, x4, y4;
+                factors_forward(prj, lp_lon + h, lp_lat + h, x1, y1);
+                factors_forward(prj, lp_lon + h, lp_lat - h, x2, y2);
+                factors_forward(prj, lp_lon - h, lp_lat - h, x3, y3);
+                factors_forward(prj, lp_lon - h, lp_lat + h, x4, y4);
+                T const d = T(4) * h;
+                if (! (fac.code & analytic_xl_yl))
+                {
+                    fac.x_l = (x1 + x2 - x3 - x4) / d;
+                    fac.y_l = (y1 + y2 - y3 - y4) / d;
+                }
+                if (! (fac.code & analytic_xp_yp))
+                {
+                    fac.x_p = (x1 - x2 - x3 + x4) / d;
+                    fac.y_p = (y1 - y2 - y3 + y4) / d;
+                }
+            }
+
+            T const cosphi = cos(lp_lat);
+            T r = T(1);
+            if (! (fac.code & analytic_hk))
+            {
+                fac.h = boost::math::hypot(fac.x_p, fac.y_p);
+                fac.k = boost::math::hypot(fac.x_l, fac.y_l) / cosphi;
+            }
+            if (es != T(0))
+            {
+                T const sinphi = sin(lp_lat);
+                T const t = T(1) - es * sinphi * sinphi;
+                if (! (fac.code & analytic_hk))
+                {
+                    T const n = sqrt(t);
+                    fac.h *= t * n / one_es;
+                    fac.k *= n;
+                }
+                r = t * t / one_es;
+            }
+            if (! (fac.code & analytic_conv))
+            {
+                fac.conv = -atan2(fac.y_l, fac.x_l);
+            }
+
+            if (shape)
+            {
+                fac.s = fac.h * fac.k * sin(fac.thetap);
+            }
+            else
+            {
+                fac.s = (fac.y_p * fac.x_l - fac.x_p * fac.y_l) * r / cosphi;
+                fac.thetap = factors_asin(fac.s / (fac.h * fac.k));
+            }
+            T const t = fac.k * fac.k + fac.h * fac.h;
+            T const sum = sqrt(t + T(2) * fac.s);
+            T const difference = t - T(2) * fac.s <= T(0) ? T(0) : sqrt(t - T(2) * fac.s);
+            fac.a = (sum + difference) / T(2);
+            fac.b = (sum - difference) / T(2);
+            fac.omega = T(2) * factors_asin((fac.a - fac.b) / (fac.a + fac.b));
+        }
+
+    } // namespace detail
+    #endif // doxygen
+
+}}} // namespace boost::geometry::projections
+
+#endif // BOOST_GEOMETRY_PROJECTIONS_IMPL_FACTORS_HPP
@@ -0,0 +1,42 @@
+#ifndef BOOST_GEOMETRY_PROJECTIONS_IMPL_PROJECTION_TRAITS_HPP
+#define BOOST_GEOMETRY_PROJECTIONS_IMPL_PROJECTION_TRAITS_HPP
+
+// Boost.Geometry - extensions-gis-projections (based on PROJ4)
+
+// Copyright (c) 2008-2015 Barend Gehrels, Amsterdam, the Netherlands.
+
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The traits shared by all projections, specialized or used by the
+// traits of each projection
+
+#include <boost/config.hpp>
+
+namespace boost { namespace geometry { namespace projections
+{
+
+    // Type of a projection parameter: flag if only its presence is tested,
+    // unknown if it is documented but not read by the projection itself
+    // (e.g. lat_0, read by the common initialization)
+    enum parameter_type
+    {
+        unknown_parameter, flag_parameter, boolean_parameter, integer_parameter,
+        real_parameter, degrees_parameter, string_parameter
+    };
+
+    // How fwd_grid of a projection transforms a grid of nlon x nlat points:
+    // per point, per row (calculating what depends on the latitude only once
+    // per row) or separable (nlon + nlat - 1 forward calls)
+    enum grid_kind { grid_points, grid_rows, grid_separable };
+
+    template <typename Projection>
+    struct grid_traits
+    {
+        BOOST_STATIC_CONSTEXPR grid_kind kind = grid_points;
+    };
+
+}}} // namespace boost::geometry::projections
+
+#endif // BOOST_GEOMETRY_PROJECTIONS_IMPL_PROJECTION_TRAITS_HPP
@@ -0,0 +1,110 @@
+#ifndef BOOST_GEOMETRY_PROJECTIONS_IMPL_SHARED_TABLES_HPP
+#define BOOST_GEOMETRY_PROJECTIONS_IMPL_SHARED_TABLES_HPP
+
+// Boost.Geometry - extensions-gis-projections (based on PROJ4)
+
+// Copyright (c) 2008-2015 Barend Gehrels, Amsterdam, the Netherlands.
+
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The ellipsoid dependent tables (en, apa, mdist), shared by all projection
+// objects with the same eccentricity
+
+#include <map>
+#include <utility>
+
+#include <boost/config.hpp>
+#ifndef BOOST_NO_CXX11_HDR_MUTEX
+#include <mutex>
+#endif
+
+#include <boost/geometry/extensions/gis/projections/impl/pj_auth.hpp>
+#include <boost/geometry/extensions/gis/projections/impl/pj_mlfn.hpp>
+#include <boost/geometry/extensions/gis/projections/impl/proj_mdist.hpp>
+
+namespace boost { namespace geometry { namespace projections
+{
+
+    #ifndef DOXYGEN_NO_DETAIL
+    namespace detail
+    {
+
+        // Returns a table of ellipsoid dependent series coefficients, calculated
+        // only once per eccentricity and shared by all projection objects.
+        // Tables are never released, so projections can keep a pointer to them:
+        // the cache holds one table per eccentricity ever set up, and grows
+        // without limit in a program setting up arbitrary es (+es, +rf) values.
+        // Access is locked by a std::mutex; without <mutex> (C++03) the tables
+        // should be set up before other threads can set them up
+        template <typename Table>
+        inline Table const* shared_table(double es, bool (*init)(double, Table&))
+        {
+            typedef std::map<double, Table> map_type;
+            static map_type* tables = 0;
+
+        #ifndef BOOST_NO_CXX11_HDR_MUTEX
+            static std::mutex mutex;
+            std::lock_guard<std::mutex> lock(mutex);
+        #endif
+            if (tables == 0)
+            {
+                tables = new map_type;
+            }
+            typename map_type::const_iterator it = tables->find(es);
+            if (it == tables->end())
+            {
+                Table table;
+                if (! init(es, table))
+                {
+                    return 0;
+                }
+                it = tables->insert(std::make_pair(es, table)).first;
+            }
+            return &(it->second);
+        }
+
+        struct shared_en_table { double en[EN_SIZE]; };
+        inline bool init_en(double es, shared_en_table& table)
+        {
+            return pj_enfn(es, table.en);
+        }
+        inline bool shared_enfn(double es, double const*& result)
+        {
+            shared_en_table const* table = shared_table(es, init_en);
+            result = table == 0 ? 0 : table->en;
+            return result != 0;
+        }
+
+        struct shared_apa_table { double apa[APA_SIZE]; };
+        inline bool init_apa(double es, shared_apa_table& table)
+        {
+            pj_authset(es, table.apa);
+            return true;
+        }
+        inline bool shared_authset(double es, double const*& result)
+        {
+            shared_apa_table const* table = shared_table(es, init_apa);
+            result = table == 0 ? 0 : table->apa;
+            return result != 0;
+        }
+
+        struct shared_mdist_table { MDIST mdist; };
+        inline bool init_mdist(double es, shared_mdist_table& table)
+        {
+            return proj_mdist_ini(es, table.mdist);
+        }
+        inline bool shared_mdist_ini(double es, MDIST const*& result)
+        {
+            shared_mdist_table const* table = shared_table(es, init_mdist);
+            result = table == 0 ? 0 : &table->mdist;
+            return result != 0;
+        }
+
+    } // namespace detail
+    #endif // doxygen
+
+}}} // namespace boost::geometry::projections
+
+#endif // BOOST_GEOMETRY_PROJECTIONS_IMPL_SHARED_TABLES_HPP
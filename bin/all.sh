@@ -12,8 +12,16 @@ export INPUT_FOLDER_PROJ4=~/svn/proj/src
 export OUTPUT_FOLDER=../bg_converted
 #export OUTPUT_FOLDER=~/git/boost/modular-boost/libs/geometry/include/boost/geometry/extensions/gis/projections/proj/
 
+# The hand-written headers shared by the converted projections (bg_impl) go
+# into impl/, next to base_static.hpp
+export IMPL_FOLDER=../bg_converted/impl
+#export IMPL_FOLDER=~/git/boost/modular-boost/libs/geometry/include/boost/geometry/extensions/gis/projections/impl/
+
 export CONVERTER=./tissot
 
+mkdir -p $IMPL_FOLDER
+cp ../bg_impl/*.hpp $IMPL_FOLDER
+
 $CONVERTER $INPUT_FOLDER_PROJ4/PJ_aea.c aea > $OUTPUT_FOLDER/aea.hpp
 $CONVERTER $INPUT_FOLDER_PROJ4/PJ_aeqd.c aeqd > $OUTPUT_FOLDER/aeqd.hpp
 $CONVERTER $INPUT_FOLDER_PROJ4/PJ_airy.c airy > $OUTPUT_FOLDER/airy.hpp
@@ -0,0 +1,51 @@
+# Tissot, converts projecton source code (Proj4) to Boost.Geometry
+# (or potentially other source code)
+#
+# Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+#
+# Use, modification and distribution is subject to the Boost Software License,
+# Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+# http://www.boost.org/LICENSE_1_0.txt)
+
+# Generates, builds and runs the benchmark and the EPSG harness of each group
+# converted in all.sh, against the converted projections. Collects the timings
+# and the EPSG round trips each in one CSV file.
+
+export INPUT_FOLDER_PROJ4=~/svn/proj/src
+
+# Boost, and the folder in which boost/geometry/extensions/gis/projections
+# contains the converted projections (in proj/)
+export BOOST_FOLDER=~/git/boost/modular-boost
+export PROJECTIONS_FOLDER=~/git/boost/modular-boost/libs/geometry/include
+
+export BENCHMARK_FOLDER=../bg_benchmark
+export RESULT=$BENCHMARK_FOLDER/benchmark.csv
+export EPSG_RESULT=$BENCHMARK_FOLDER/epsg.csv
+
+export CONVERTER=./tissot
+export COMPILER="g++ -O2 -DNDEBUG"
+
+mkdir -p $BENCHMARK_FOLDER
+echo "group,projection,model,direction,points,ns_per_point" > $RESULT
+echo "epsg,projection,status,points,failed,max_error_m,ns_per_roundtrip" > $EPSG_RESULT
+
+# Use the groups (and their sources) listed in all.sh
+grep '^\$CONVERTER' all.sh | while read converter source group rest
+do
+    source=`echo $source | sed "s|\\$INPUT_FOLDER_PROJ4|$INPUT_FOLDER_PROJ4|"`
+    $CONVERTER $source $group --benchmark > $BENCHMARK_FOLDER/$group.cpp 2> /dev/null
+    if $COMPILER -I $PROJECTIONS_FOLDER -I $BOOST_FOLDER -o $BENCHMARK_FOLDER/$group $BENCHMARK_FOLDER/$group.cpp
+    then
+        $BENCHMARK_FOLDER/$group --no-header >> $RESULT
+    else
+        echo "$group: benchmark not compiled"
+    fi
+
+    $CONVERTER $source $group --epsg-harness > $BENCHMARK_FOLDER/${group}_epsg.cpp 2> /dev/null
+    if $COMPILER -I $PROJECTIONS_FOLDER -I $BOOST_FOLDER -o $BENCHMARK_FOLDER/${group}_epsg $BENCHMARK_FOLDER/${group}_epsg.cpp
+    then
+        $BENCHMARK_FOLDER/${group}_epsg --no-header >> $EPSG_RESULT
+    else
+        echo "$group: EPSG harness not compiled"
+    fi
+done
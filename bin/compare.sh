@@ -0,0 +1,68 @@
+# Tissot, converts projecton source code (Proj4) to Boost.Geometry
+# (or potentially other source code)
+#
+# Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+#
+# Use, modification and distribution is subject to the Boost Software License,
+# Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+# http://www.boost.org/LICENSE_1_0.txt)
+
+# Builds proj4 from the sources converted by all.sh, and compares each group
+# converted in all.sh with proj4: timing of forward and inverse on identical
+# input, their ratio (above 1: generated code is faster) and max difference
+
+# Use the same proj4 sources as all.sh
+eval `grep '^export INPUT_FOLDER_PROJ4=' all.sh`
+
+# Boost, and the folder in which boost/geometry/extensions/gis/projections
+# contains the converted projections (in proj/)
+export BOOST_FOLDER=~/git/boost/modular-boost
+export PROJECTIONS_FOLDER=~/git/boost/modular-boost/libs/geometry/include
+
+# Static library, built by proj4's own build if it is not there
+export PROJ4_LIBRARY=$INPUT_FOLDER_PROJ4/.libs/libproj.a
+
+export COMPARE_FOLDER=../bg_compare
+export RESULT=$COMPARE_FOLDER/compare.csv
+
+export CONVERTER=./tissot
+export COMPILER="g++ -O2 -DNDEBUG"
+
+if [ ! -f $PROJ4_LIBRARY ]
+then
+    (cd $INPUT_FOLDER_PROJ4/.. && ./configure --disable-shared && make) || exit 1
+fi
+
+mkdir -p $COMPARE_FOLDER
+echo "group,projection,model,direction,points,ns_generated,ns_proj4,speed_ratio,max_difference_m" > $RESULT
+
+grep '^\$CONVERTER' all.sh | while read converter source group rest
+do
+    source=`echo $source | sed "s|\\$INPUT_FOLDER_PROJ4|$INPUT_FOLDER_PROJ4|"`
+    $CONVERTER $source $group --compare-proj4 > $COMPARE_FOLDER/$group.cpp 2> /dev/null
+    if $COMPILER -I $INPUT_FOLDER_PROJ4 -I $PROJECTIONS_FOLDER -I $BOOST_FOLDER -o $COMPARE_FOLDER/$group $COMPARE_FOLDER/$group.cpp $PROJ4_LIBRARY -lm -lpthread
+    then
+        $COMPARE_FOLDER/$group --no-header >> $RESULT
+    else
+        echo "$group: comparison not compiled"
+    fi
+done
+
+# Differential run of the unrolled etmerc series (--unroll-series) against
+# proj4's summation loops, the converted header shadows the one of all.sh
+UNROLLED_FOLDER=$COMPARE_FOLDER/unrolled
+mkdir -p $UNROLLED_FOLDER/boost/geometry/extensions/gis/projections/proj
+$CONVERTER $INPUT_FOLDER_PROJ4/proj_etmerc.c etmerc --unroll-series > $UNROLLED_FOLDER/boost/geometry/extensions/gis/projections/proj/etmerc.hpp 2> /dev/null
+$CONVERTER $INPUT_FOLDER_PROJ4/proj_etmerc.c etmerc --compare-proj4 > $COMPARE_FOLDER/etmerc_unrolled.cpp 2> /dev/null
+if $COMPILER -I $INPUT_FOLDER_PROJ4 -I $UNROLLED_FOLDER -I $PROJECTIONS_FOLDER -I $BOOST_FOLDER -o $COMPARE_FOLDER/etmerc_unrolled $COMPARE_FOLDER/etmerc_unrolled.cpp $PROJ4_LIBRARY -lm -lpthread
+then
+    $COMPARE_FOLDER/etmerc_unrolled --no-header | sed 's/^etmerc,/etmerc_unrolled,/' >> $RESULT
+else
+    echo "etmerc_unrolled: comparison not compiled"
+fi
+
+# The unrolled series should agree with the loops within a micrometre
+awk -F, '$1 == "etmerc_unrolled" && $9 > 1e-6 { print "unrolled series differ: " $2 " " $3 " " $4 " " $9 " m" }' $RESULT
+
+# List the projections where the generated code is slower than proj4
+awk -F, 'NR > 1 && $8 > 0 && $8 < 1 { print "slower than proj4: " $1 " " $2 " " $3 " " $4 " ratio " $8 }' $RESULT
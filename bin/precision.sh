@@ -0,0 +1,42 @@
+# Tissot, converts projecton source code (Proj4) to Boost.Geometry
+# (or potentially other source code)
+#
+# Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+#
+# Use, modification and distribution is subject to the Boost Software License,
+# Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+# http://www.boost.org/LICENSE_1_0.txt)
+
+# Generates, builds and runs the precision report (float compared to double)
+# of each group converted in all.sh, against the converted projections.
+# Every group, also the ones using (igh) or linking (ob_tran) other
+# projections, is instantiated in float: a group not compiling is reported.
+
+export INPUT_FOLDER_PROJ4=~/svn/proj/src
+
+# Boost, and the folder in which boost/geometry/extensions/gis/projections
+# contains the converted projections (in proj/)
+export BOOST_FOLDER=~/git/boost/modular-boost
+export PROJECTIONS_FOLDER=~/git/boost/modular-boost/libs/geometry/include
+
+export PRECISION_FOLDER=../bg_precision
+export RESULT=$PRECISION_FOLDER/precision.txt
+
+export CONVERTER=./tissot
+export COMPILER="g++ -O2 -DNDEBUG"
+
+mkdir -p $PRECISION_FOLDER
+> $RESULT
+
+# Use the groups (and their sources) listed in all.sh
+grep '^\$CONVERTER' all.sh | while read converter source group rest
+do
+    source=`echo $source | sed "s|\\$INPUT_FOLDER_PROJ4|$INPUT_FOLDER_PROJ4|"`
+    $CONVERTER $source $group --precision-report > $PRECISION_FOLDER/$group.cpp 2> /dev/null
+    if $COMPILER -I $PROJECTIONS_FOLDER -I $BOOST_FOLDER -o $PRECISION_FOLDER/$group $PRECISION_FOLDER/$group.cpp
+    then
+        $PRECISION_FOLDER/$group >> $RESULT
+    else
+        echo "$group: float instantiation not compiled" | tee -a $RESULT
+    fi
+done
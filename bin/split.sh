@@ -0,0 +1,33 @@
+# Tissot, converts projecton source code (Proj4) to Boost.Geometry
+# (or potentially other source code)
+#
+# Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+#
+# Use, modification and distribution is subject to the Boost Software License,
+# Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+# http://www.boost.org/LICENSE_1_0.txt)
+
+# Converts each group of all.sh into a light declaration header (<group>_fwd.hpp),
+# the implementation header including it (<group>.hpp), and a source file with
+# explicit instantiations for the common double based point types (<group>.cpp).
+# Define BOOST_GEOMETRY_PROJECTIONS_EXTERN_INSTANTIATIONS (C++11) and link the
+# instantiations to avoid instantiating them again in each translation unit.
+
+eval `grep '^export INPUT_FOLDER_PROJ4=' all.sh`
+
+export OUTPUT_FOLDER=../bg_converted
+export SOURCE_FOLDER=../bg_converted
+export IMPL_FOLDER=../bg_converted/impl
+
+export CONVERTER=./tissot
+
+mkdir -p $IMPL_FOLDER
+cp ../bg_impl/*.hpp $IMPL_FOLDER
+
+grep '^\$CONVERTER' all.sh | while read converter source group rest
+do
+    source=`echo $source | sed "s|\\$INPUT_FOLDER_PROJ4|$INPUT_FOLDER_PROJ4|"`
+    $CONVERTER $source $group --split > $OUTPUT_FOLDER/$group.hpp
+    $CONVERTER $source $group --declarations > $OUTPUT_FOLDER/${group}_fwd.hpp 2> /dev/null
+    $CONVERTER $source $group --instantiations > $SOURCE_FOLDER/$group.cpp 2> /dev/null
+done
@@ -14,6 +14,10 @@
 #include "tissot_util.hpp"
 #include "converter_base.hpp"
 
+#include <cstdlib>
+
+#include <boost/lexical_cast.hpp>
+
 namespace boost { namespace geometry { namespace proj4converter
 {
 
@@ -51,6 +55,10 @@ class converter_cpp_bg_etmerc : public converter_cpp_bg_default
                 boost::replace_all(line, "p = a + size;", "const double* p = a + size;");
             }
 
+            if (m_prop.options.count("unroll-series") > 0)
+            {
+                unroll_series(m_prop.inlined_functions);
+            }
         }
 
         void remove_conditional_code(std::vector<std::string>& lines)
@@ -86,6 +94,195 @@ class converter_cpp_bg_etmerc : public converter_cpp_bg_default
 
     private :
 
+        static std::string str(int i)
+        {
+            return boost::lexical_cast<std::string>(i);
+        }
+
+        // Returns "prefix" + i, e.g. hr3, or "array[i]"
+        static std::string var(std::string const& prefix, int i)
+        {
+            return prefix + str(i);
+        }
+        static std::string elem(std::string const& array, int i)
+        {
+            return array + "[" + str(i) + "]";
+        }
+
+        // Emits the Clenshaw recurrence b(k) = r * b(k+1) - b(k+2) + a[k],
+        // unrolled from k = order - 1 to 0, with fused multiply-adds
+        static void add_real_clenshaw(std::vector<std::string>& lines,
+                    std::string const& array, std::string const& r,
+                    std::string const& prefix, int order)
+        {
+            for (int k = order - 1; k >= 0; k--)
+            {
+                std::string value;
+                if (k == order - 1)
+                {
+                    value = elem(array, k);
+                }
+                else if (k == order - 2)
+                {
+                    value = "fused_multiply_add(" + r + ", " + var(prefix, k + 1) + ", " + elem(array, k) + ")";
+                }
+                else
+                {
+                    value = "fused_multiply_add(" + r + ", " + var(prefix, k + 1) + ", "
+                        + elem(array, k) + " - " + var(prefix, k + 2) + ")";
+                }
+                lines.push_back(tab1 + "double const " + var(prefix, k) + " = " + value + ";");
+            }
+        }
+
+        // Idem, for the complex recurrence of clenS, with r and i the real
+        // and imaginary part of the multiplier
+        static void add_complex_clenshaw(std::vector<std::string>& lines, int order)
+        {
+            for (int k = order - 1; k >= 0; k--)
+            {
+                std::string re, im;
+                if (k == order - 1)
+                {
+                    re = elem("a", k);
+                    im = "0";
+                }
+                else if (k == order - 2)
+                {
+                    re = "fused_multiply_add(r, " + var("hr", k + 1) + ", " + elem("a", k) + ")";
+                    im = "i*" + var("hr", k + 1);
+                }
+                else
+                {
+                    re = "fused_multiply_add(r, " + var("hr", k + 1) + ", fused_multiply_add(-i, " + var("hi", k + 1)
+                        + ", " + elem("a", k) + " - " + var("hr", k + 2) + "))";
+                    im = k == order - 3
+                        ? "fused_multiply_add(i, " + var("hr", k + 1) + ", r*" + var("hi", k + 1) + ")"
+                        : "fused_multiply_add(i, " + var("hr", k + 1) + ", fused_multiply_add(r, " + var("hi", k + 1)
+                            + ", -" + var("hi", k + 2) + "))";
+                }
+                lines.push_back(tab1 + "double const " + var("hr", k) + " = " + re + ";");
+                if (k < order - 1 || order == 1)
+                {
+                    lines.push_back(tab1 + "double const " + var("hi", k) + " = " + im + ";");
+                }
+            }
+        }
+
+        static std::vector<std::string> unrolled(std::string const& function, int order)
+        {
+            std::string const comment = "/* summation, unrolled for PROJ_ETMERC_ORDER = " + str(order) + " */";
+            std::vector<std::string> lines;
+            if (function == "gatg")
+            {
+                lines.push_back("gatg(const double *p1, int /*len_p1*/, double B) {");
+                lines.push_back(tab1 + "double const cos_2B = 2*cos(2*B);");
+                lines.push_back(tab1 + comment);
+                add_real_clenshaw(lines, "p1", "cos_2B", "h", order);
+                lines.push_back(tab1 + "return (B + h0*sin(2*B));");
+            }
+            else if (function == "clens")
+            {
+                lines.push_back("clens(const double *a, int /*size*/, double arg_r) {");
+                lines.push_back(tab1 + "double const r = 2*cos(arg_r);");
+                lines.push_back(tab1 + comment);
+                add_real_clenshaw(lines, "a", "r", "hr", order);
+                lines.push_back(tab1 + "return(sin(arg_r)*hr0);");
+            }
+            else
+            {
+                lines.push_back("clenS(const double *a, int /*size*/, double arg_r, double arg_i, double *R, double *I) {");
+                lines.push_back(tab1 + "/* arguments */");
+                lines.push_back(tab1 + "double const sin_arg_r  = sin(arg_r);");
+                lines.push_back(tab1 + "double const cos_arg_r  = cos(arg_r);");
+                lines.push_back(tab1 + "double const sinh_arg_i = sinh(arg_i);");
+                lines.push_back(tab1 + "double const cosh_arg_i = cosh(arg_i);");
+                lines.push_back(tab1 + "double const r          =  2*cos_arg_r*cosh_arg_i;");
+                lines.push_back(tab1 + "double const i          = -2*sin_arg_r*sinh_arg_i;");
+                lines.push_back(tab1 + comment);
+                add_complex_clenshaw(lines, order);
+                lines.push_back(tab1 + "double const sr = sin_arg_r*cosh_arg_i;");
+                lines.push_back(tab1 + "double const si = cos_arg_r*sinh_arg_i;");
+                lines.push_back(tab1 + "*R  = sr*hr0 - si*hi0;");
+                lines.push_back(tab1 + "*I  = sr*hi0 + si*hr0;");
+                lines.push_back(tab1 + "return(*R);");
+            }
+            lines.push_back("}");
+            return lines;
+        }
+
+        // Replaces the pointer walking loops of gatg, clens and clenS by
+        // fixed order, fully unrolled Clenshaw summations using fma. The
+        // order is known at conversion time (PROJ_ETMERC_ORDER)
+        void unroll_series(std::vector<std::string>& lines)
+        {
+            std::vector<macro_or_const>::const_iterator cit
+                = std::find_if(m_prop.defined_consts.begin(), m_prop.defined_consts.end(),
+                        functor_equals_in_named_struct("PROJ_ETMERC_ORDER"));
+            int const order = cit == m_prop.defined_consts.end()
+                ? 0 : std::atoi(cit->value.c_str());
+            if (order < 1)
+            {
+                std::cerr << "etmerc: order of series unknown, not unrolled" << std::endl;
+                return;
+            }
+
+            // std::fma is C++11, in C++03 the fallback is a (not fused) multiply-add.
+            // Boost.Config has no macro for the C++11 <cmath>, and MSVC keeps
+            // __cplusplus at 199711L (unless /Zc:__cplusplus), so it is tested
+            // via BOOST_MSVC (std::fma is there since Visual Studio 2013)
+            std::string const helper[] =
+                {
+                    "inline double fused_multiply_add(double a, double b, double c)",
+                    "{",
+                    "#if __cplusplus >= 201103L || (defined(BOOST_MSVC) && BOOST_MSVC >= 1800)",
+                    tab1 + "return std::fma(a, b, c);",
+                    "#else",
+                    tab1 + "return a * b + c;",
+                    "#endif",
+                    "}",
+                    ""
+                };
+            bool helper_inserted = false;
+
+            char const* functions[] = { "gatg(", "clens(", "clenS(" };
+            for (std::size_t f = 0; f < 3; f++)
+            {
+                std::vector<std::string>::iterator it
+                    = std::find_if(lines.begin(), lines.end(), functor_starts_with(functions[f]));
+                // The function ends with the first non indented closing brace
+                std::vector<std::string>::iterator end = it;
+                while (end != lines.end() && boost::trim_right_copy(*end) != "}")
+                {
+                    ++end;
+                }
+                if (it == lines.end() || end == lines.end())
+                {
+                    std::cerr << "etmerc: function " << functions[f] << ") not found" << std::endl;
+                    continue;
+                }
+                std::string name = functions[f];
+                name.erase(name.size() - 1);
+                std::vector<std::string> replacement = unrolled(name, order);
+                if (! helper_inserted)
+                {
+                    // Before the return type, on the line above the name
+                    if (it != lines.begin() && ! boost::trim_copy(*(it - 1)).empty())
+                    {
+                        --it;
+                        replacement.insert(replacement.begin(), *it);
+                    }
+                    replacement.insert(replacement.begin(), helper,
+                            helper + sizeof(helper) / sizeof(helper[0]));
+                    m_prop.extra_includes.insert("boost/config.hpp");
+                    m_prop.extra_includes.insert("cmath");
+                    helper_inserted = true;
+                }
+                it = lines.erase(it, end + 1);
+                lines.insert(it, replacement.begin(), replacement.end());
+            }
+        }
+
         projection_properties& m_prop;
 };
 
@@ -29,8 +29,8 @@ class converter_cpp_bg_goode  : public converter_cpp_bg_default
 
         void convert()
         {
-            // Goode is a projection combining moll/sinu
-            m_prop.template_struct = "<Geographic, Cartesian, Parameters>";
+            // Goode is a projection combining moll/sinu, calculating in the same type
+            m_prop.template_struct = "<Geographic, Cartesian, Parameters, CalculationType>";
             m_prop.extra_proj_includes.insert("moll.hpp");
             m_prop.extra_proj_includes.insert("gn_sinu.hpp");
 
@@ -38,8 +38,8 @@ class converter_cpp_bg_goode  : public converter_cpp_bg_default
 
             // Basically we replace most of it here...
             m_prop.proj_parameters.clear();
-            m_prop.proj_parameters.push_back("sinu_ellipsoid<Geographic, Cartesian, Parameters>    sinu;");
-            m_prop.proj_parameters.push_back("moll_spheroid<Geographic, Cartesian, Parameters>    moll;");
+            m_prop.proj_parameters.push_back("sinu_ellipsoid<Geographic, Cartesian, Parameters, CalculationType>    sinu;");
+            m_prop.proj_parameters.push_back("moll_spheroid<Geographic, Cartesian, Parameters, CalculationType>    moll;");
             m_prop.proj_parameters.push_back("");
             m_prop.proj_parameters.push_back("par_goode(const Parameters& par) : sinu(par), moll(par) {}");
 
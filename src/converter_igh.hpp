@@ -13,6 +13,8 @@
 #include "tissot_structs.hpp"
 #include "tissot_util.hpp"
 #include "converter_base.hpp"
+#include <cstdlib>
+#include <sstream>
 
 namespace boost { namespace geometry { namespace proj4converter
 {
@@ -28,28 +30,32 @@ public :
 
     void convert()
     {
-        m_prop.template_struct = "<Geographic, Cartesian>";
+        // The sinu/moll sub-projections are held by value (as in goode),
+        // calculating in the same type, the offsets of the 12 zones are
+        // kept separately
+        m_prop.template_struct = "<Geographic, Cartesian, Parameters, CalculationType>";
         m_prop.extra_proj_includes.insert("gn_sinu.hpp");
         m_prop.extra_proj_includes.insert("moll.hpp");
 
-        BOOST_FOREACH(std::string& line, m_prop.proj_parameters)
-        {
-            boost::replace_all(line, "struct PJconsts*", "boost::shared_ptr<projection<Geographic, Cartesian> >");
-        }
+        m_prop.extra_member_initialization_list.push_back("m_proj_parm(par)");
+
+        update_proj_parameters(m_prop.proj_parameters);
 
         BOOST_FOREACH(derived& d, m_prop.derived_projections)
         {
             update_setup(d.constructor_lines);
-            update_proj_parm(d.constructor_lines, "mutable_");
+            update_proj_parm(d.constructor_lines);
         }
         update_inlined(m_prop.inlined_functions);
+        add_zone_table(m_prop.inlined_functions);
 
-        update_proj_parm(m_prop.inlined_functions, "mutable_");
+        update_proj_parm(m_prop.inlined_functions);
 
         BOOST_FOREACH(projection& proj, m_prop.projections)
         {
             update_projection(proj.lines);
-            update_proj_parm(proj.lines, "");
+            update_zone_selection(proj.lines);
+            update_proj_parm(proj.lines);
         }
 
     }
@@ -66,6 +72,93 @@ private :
             );
     }
 
+    void update_proj_parameters(std::vector<std::string>& lines)
+    {
+        BOOST_FOREACH(std::string& line, lines)
+        {
+            if (boost::contains(line, "pj[12]"))
+            {
+                line = "par_igh_zone zones[12];";
+            }
+        }
+
+        std::vector<std::string> sub;
+        sub.push_back("sinu_spheroid<Geographic, Cartesian, Parameters, CalculationType> sinu;");
+        sub.push_back("moll_spheroid<Geographic, Cartesian, Parameters, CalculationType> moll;");
+        lines.insert(lines.begin(), sub.begin(), sub.end());
+
+        // Sub projections are spherical, and get a copy of the coordinates,
+        // they might modify them
+        lines.push_back("");
+        lines.push_back("par_igh(const Parameters& par) : sinu(spherical(par)), moll(spherical(par)) {}");
+        lines.push_back("");
+        lines.push_back("static inline Parameters spherical(Parameters par)");
+        lines.push_back("{");
+        lines.push_back(tab1 + "par.es = 0.;");
+        lines.push_back(tab1 + "return par;");
+        lines.push_back("}");
+        lines.push_back("");
+        lines.push_back("// Zones 1, 2, 9, 10, 11 and 12 are Mollweide, the others Sinusoidal");
+        lines.push_back("inline void fwd(int z, CalculationType lp_lon, CalculationType lp_lat,");
+        lines.push_back(tab2 + "CalculationType& xy_x, CalculationType& xy_y) const");
+        lines.push_back("{");
+        lines.push_back(tab1 + "if (z <= 2 || z >= 9) moll.fwd(lp_lon, lp_lat, xy_x, xy_y);");
+        lines.push_back(tab1 + "else sinu.fwd(lp_lon, lp_lat, xy_x, xy_y);");
+        lines.push_back("}");
+        lines.push_back("");
+        lines.push_back("inline void inv(int z, CalculationType xy_x, CalculationType xy_y,");
+        lines.push_back(tab2 + "CalculationType& lp_lon, CalculationType& lp_lat) const");
+        lines.push_back("{");
+        lines.push_back(tab1 + "if (z <= 2 || z >= 9) moll.inv(xy_x, xy_y, lp_lon, lp_lat);");
+        lines.push_back(tab1 + "else sinu.inv(xy_x, xy_y, lp_lon, lp_lat);");
+        lines.push_back("}");
+
+        m_prop.extra_structs.push_back("// Offsets of each of the 12 zones");
+        m_prop.extra_structs.push_back("struct par_igh_zone");
+        m_prop.extra_structs.push_back("{");
+        m_prop.extra_structs.push_back(tab1 + "double x0;");
+        m_prop.extra_structs.push_back(tab1 + "double y0;");
+        m_prop.extra_structs.push_back(tab1 + "double lam0;");
+        m_prop.extra_structs.push_back("};");
+    }
+
+    void add_zone_table(std::vector<std::string>& lines)
+    {
+        lines.push_back("");
+        lines.push_back("// Zone boundaries: per band (from north to south) its southern");
+        lines.push_back("// boundary (lat or y), its first zone, and the boundaries between");
+        lines.push_back("// its zones (lon or x). Used by both forward and inverse");
+        lines.push_back("struct igh_band");
+        lines.push_back("{");
+        lines.push_back(tab1 + "double lat;");
+        lines.push_back(tab1 + "int first;");
+        lines.push_back(tab1 + "double lon[3];");
+        lines.push_back("};");
+        lines.push_back("");
+        lines.push_back("static const igh_band igh_bands[4] =");
+        lines.push_back("{");
+        lines.push_back(tab1 + "{  d4044118, 1, {  -d40, HUGE_VAL, HUGE_VAL } }, // 1|2");
+        lines.push_back(tab1 + "{         0, 3, {  -d40, HUGE_VAL, HUGE_VAL } }, // 3|4");
+        lines.push_back(tab1 + "{ -d4044118, 5, { -d100,     -d20,      d80 } }, // 5|6|7|8");
+        lines.push_back(tab1 + "{ -HUGE_VAL, 9, { -d100,     -d20,      d80 } }  // 9|10|11|12");
+        lines.push_back("};");
+        lines.push_back("");
+        lines.push_back("inline int igh_zone(double lon, double lat)");
+        lines.push_back("{");
+        lines.push_back(tab1 + "igh_band const* band = igh_bands;");
+        lines.push_back(tab1 + "while (lat < band->lat)");
+        lines.push_back(tab1 + "{");
+        lines.push_back(tab2 + "++band;");
+        lines.push_back(tab1 + "}");
+        lines.push_back(tab1 + "int z = band->first;");
+        lines.push_back(tab1 + "for (int i = 0; i < 3 && lon > band->lon[i]; i++)");
+        lines.push_back(tab1 + "{");
+        lines.push_back(tab2 + "z++;");
+        lines.push_back(tab1 + "}");
+        lines.push_back(tab1 + "return z;");
+        lines.push_back("}");
+    }
+
     void update_projection(std::vector<std::string>& lines)
     {
         BOOST_FOREACH(std::string& line, lines)
@@ -85,15 +178,81 @@ private :
         }
     }
 
-    void update_proj_parm(std::vector<std::string>& lines, std::string const& prefix)
+    // Replaces the cascade of comparisons selecting the zone by a call to igh_zone
+    void update_zone_selection(std::vector<std::string>& lines)
+    {
+        std::vector<std::string>::iterator start = lines.begin();
+        while (start != lines.end() && ! boost::contains(*start, "d4044118"))
+        {
+            ++start;
+        }
+        std::vector<std::string>::iterator end = start;
+        while (end != lines.end() && ! boost::contains(*end, "pj[z-1]")
+            && boost::trim_copy(*end) != "if (z)")
+        {
+            ++end;
+        }
+        if (start == lines.end() || end == lines.end())
+        {
+            return;
+        }
+        while (end != start && boost::trim_copy(*(end - 1)).empty())
+        {
+            --end;
+        }
+
+        std::string const indent = start->substr(0, start->find_first_not_of(' '));
+        std::vector<std::string> piece;
+        if (boost::contains(*start, "lp_lat"))
+        {
+            // Forward, combine with declaration
+            if (start != lines.begin() && boost::trim_copy(*(start - 1)) == "int z;")
+            {
+                --start;
+            }
+            piece.push_back(indent + "int z = igh_zone(lp_lon, lp_lat);");
+        }
+        else
+        {
+            // Inverse, preceded by check on y
+            piece.push_back(indent + "else");
+            piece.push_back(indent + "  z = igh_zone(xy_x, xy_y);");
+        }
+        start = lines.erase(start, end);
+        lines.insert(start, piece.begin(), piece.end());
+    }
+
+    // Replaces usages of the sub projections, "pj[z-1]->fwd(" by
+    // "fwd(z, " and "pj[0]->params().x0" by "zones[0].x0"
+    void update_proj_parm(std::vector<std::string>& lines)
     {
         BOOST_FOREACH(std::string& line, lines)
         {
-            if (boost::contains(line, "proj_parm")
-                && ! boost::contains(line, "fwd")
-                && ! boost::contains(line, "inv"))
+            std::string::size_type loc;
+            while (find(line, "pj[", loc))
             {
-                boost::replace_all(line, "]->", std::string("]->") + prefix + "params().");
+                std::string::size_type const close = line.find("]->", loc);
+                if (close == std::string::npos)
+                {
+                    break;
+                }
+                std::string const index = line.substr(loc + 3, close - loc - 3);
+                std::string const rest = line.substr(close + 3);
+                if (boost::starts_with(rest, "fwd(") || boost::starts_with(rest, "inv("))
+                {
+                    std::string zone = boost::replace_all_copy(index, "-1", "");
+                    if (! index.empty() && std::isdigit(index[0]))
+                    {
+                        std::ostringstream out;
+                        out << atoi(index.c_str()) + 1;
+                        zone = out.str();
+                    }
+                    line.replace(loc, close + 7 - loc, rest.substr(0, 4) + zone + ", ");
+                }
+                else
+                {
+                    line.replace(loc, close + 3 - loc, "zones[" + index + "].");
+                }
             }
         }
     }
@@ -119,11 +278,9 @@ private :
 
                 m_prop.inlined_functions.push_back("");
                 m_prop.inlined_functions.push_back(std::string("// Converted from ") + boost::replace_last_copy(*start, "\\", ""));
-                m_prop.inlined_functions.push_back("template <template <typename, typename, typename> class Entry, typename Parameters, typename Geographic, typename Cartesian>");
-                m_prop.inlined_functions.push_back("inline void do_setup(int n, Parameters const& par, par_igh<Geographic, Cartesian>& proj_parm, double x_0, double y_0, double lon_0)");
+                m_prop.inlined_functions.push_back("template <typename Geographic, typename Cartesian, typename Parameters, typename CalculationType>");
+                m_prop.inlined_functions.push_back("inline void do_setup(int n, par_igh<Geographic, Cartesian, Parameters, CalculationType>& proj_parm, double x_0, double y_0, double lon_0)");
                 m_prop.inlined_functions.push_back("{");
-                m_prop.inlined_functions.push_back(tab1 + "Entry<Geographic, Cartesian, Parameters> entry;");
-                m_prop.inlined_functions.push_back(tab1 + "proj_parm.pj[n-1].reset(entry.create_new(par));");
 
                 for (std::vector<std::string>::const_iterator it = start + 1;
                     it != end; ++it)
@@ -145,21 +302,18 @@ private :
 
         BOOST_FOREACH(std::string& line, lines)
         {
-            if (boost::contains(line, "moll") && boost::contains(line, "SETUP"))
-            {
-                boost::replace_first(line, "moll", "par, proj_parm");
-                boost::replace_first(line, "SETUP", "do_setup<moll_entry>");
-            }
-            else if (boost::contains(line, "sinu") && boost::contains(line, "SETUP"))
+            if ((boost::contains(line, "moll") || boost::contains(line, "sinu"))
+                && boost::contains(line, "SETUP"))
             {
-                boost::replace_first(line, "sinu", "par, proj_parm");
-                boost::replace_first(line, "SETUP", "do_setup<sinu_entry>");
+                boost::replace_first(line, "moll", "proj_parm");
+                boost::replace_first(line, "sinu", "proj_parm");
+                boost::replace_first(line, "SETUP", "do_setup");
             }
 
-            // Replace LP/XY with doubles
-            boost::replace_all(line, "LP lp = { 0, d4044118 };", "double lp_lam = 0, lp_phi = d4044118;");
-            boost::replace_all(line, "XY xy1;", "double xy1_x, xy1_y;");
-            boost::replace_all(line, "XY xy3;", "double xy3_x, xy3_y;");
+            // Replace LP/XY with separate coordinates, in the calculation type
+            boost::replace_all(line, "LP lp = { 0, d4044118 };", "CalculationType lp_lam = 0, lp_phi = CalculationType(d4044118);");
+            boost::replace_all(line, "XY xy1;", "CalculationType xy1_x, xy1_y;");
+            boost::replace_all(line, "XY xy3;", "CalculationType xy3_x, xy3_y;");
             boost::replace_all(line, "xy1 =", "");
             boost::replace_all(line, "xy3 =", "");
 
@@ -98,7 +98,11 @@ class converter_cpp_bg_isea : public converter_cpp_bg_default
                 }
             }
 
-            // Provide const-correctness, don't use/change parameters
+            // Provide const-correctness, don't use/change parameters.
+            // The state of the last transformed point is moved out of
+            // isea_dgg into a small struct living on the stack of fwd
+            split_scratch(lines);
+
             BOOST_FOREACH(projection& proj, m_prop.projections)
             {
                 std::vector<std::string>& lines = proj.lines;
@@ -108,8 +112,9 @@ class converter_cpp_bg_isea : public converter_cpp_bg_default
                 if (it != lines.end())
                 {
                     // First replace current line, then insert the decl before
-                    boost::replace_all(*it, "&this->m_proj_parm.dgg", "&copy");
-                    lines.insert(it, tab1 + "isea_dgg copy = this->m_proj_parm.dgg;");
+                    boost::replace_all(*it, "&this->m_proj_parm.dgg,",
+                            "&this->m_proj_parm.dgg, &scratch,");
+                    lines.insert(it, tab1 + "isea_scratch scratch;");
                 }
             }
 
@@ -120,6 +125,162 @@ class converter_cpp_bg_isea : public converter_cpp_bg_default
 
     private :
 
+        static bool is_scratch_field(std::string const& name)
+        {
+            return name == "triangle" || name == "quad" || name == "serial";
+        }
+
+        static bool is_scratch_declaration(std::string const& line)
+        {
+            std::string decl = line;
+            strip_comments(decl);
+            boost::erase_all(decl, " ");
+            boost::erase_all(decl, "\t");
+            return decl == "inttriangle;" || decl == "intquad;"
+                || decl == "unsignedlongserial;";
+        }
+
+        // Returns true if the line assigns to another member of isea_dgg g
+        // than the per call state (triangle, quad, serial)
+        static bool assigns_config(std::string const& line)
+        {
+            std::string::size_type loc = line.find("g->");
+            while (loc != std::string::npos)
+            {
+                std::string::size_type pos = loc + 3;
+                std::string name;
+                while (pos < line.size()
+                    && (std::isalnum(line[pos]) || line[pos] == '_'))
+                {
+                    name += line[pos++];
+                }
+                while (pos < line.size() && line[pos] == ' ')
+                {
+                    pos++;
+                }
+                bool const assigned = pos + 1 < line.size()
+                    && line[pos] == '=' && line[pos + 1] != '=';
+                if (assigned && ! is_scratch_field(name))
+                {
+                    return true;
+                }
+                loc = line.find("g->", pos);
+            }
+            return false;
+        }
+
+        static std::string::size_type find_dgg_parameter(std::string const& line,
+                    std::string& parameter)
+        {
+            char const* candidates[] = { "struct isea_dgg *g", "struct isea_dgg * g" };
+            for (std::size_t i = 0; i < 2; i++)
+            {
+                std::string::size_type loc = line.find(candidates[i]);
+                if (loc != std::string::npos)
+                {
+                    parameter = candidates[i];
+                    return loc;
+                }
+            }
+            return std::string::npos;
+        }
+
+        // Moves triangle, quad and serial from isea_dgg into isea_scratch.
+        // Functions which do not change the configuration get a const
+        // isea_dgg and the scratch as an extra parameter. The grid is then
+        // never modified or copied by the forward transformation.
+        void split_scratch(std::vector<std::string>& lines)
+        {
+            std::vector<std::string>::iterator it
+                = std::find_if(lines.begin(), lines.end(),
+                        functor_starts_with("struct isea_dgg {"));
+            if (it == lines.end())
+            {
+                std::cerr << "isea: struct isea_dgg not found" << std::endl;
+                return;
+            }
+
+            std::vector<std::string> fields;
+            while (it != lines.end() && boost::trim_copy(*it) != "};")
+            {
+                if (is_scratch_declaration(*it))
+                {
+                    fields.push_back(*it);
+                    it = lines.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            if (it == lines.end() || fields.empty())
+            {
+                std::cerr << "isea: no per call state found in isea_dgg" << std::endl;
+                return;
+            }
+
+            std::vector<std::string> scratch;
+            scratch.push_back("");
+            scratch.push_back("/* per call state, not part of isea_dgg such that that can be const */");
+            scratch.push_back("struct isea_scratch {");
+            scratch.insert(scratch.end(), fields.begin(), fields.end());
+            scratch.push_back("};");
+            lines.insert(it + 1, scratch.begin(), scratch.end());
+
+            // Collect the functions reading the configuration only
+            std::set<std::string> functions;
+            std::vector<std::pair<std::size_t, std::size_t> > bodies;
+            for (std::size_t i = 0; i < lines.size(); i++)
+            {
+                std::string parameter;
+                std::string::size_type const loc = find_dgg_parameter(lines[i], parameter);
+                std::string::size_type const open = lines[i].find("(");
+                if (loc == std::string::npos || open == std::string::npos || open > loc)
+                {
+                    continue;
+                }
+
+                std::size_t end = i + 1;
+                bool config = false;
+                while (end < lines.size() && ! boost::starts_with(lines[end], "}"))
+                {
+                    config = config || assigns_config(lines[end]);
+                    end++;
+                }
+                if (! config)
+                {
+                    std::string name = lines[i].substr(0, open);
+                    boost::trim(name);
+                    std::string::size_type const space = name.find_last_of(" *");
+                    if (space != std::string::npos)
+                    {
+                        name.erase(0, space + 1);
+                    }
+                    functions.insert(name);
+                    bodies.push_back(std::make_pair(i, end));
+
+                    boost::replace_first(lines[i], parameter,
+                        "const struct isea_dgg *g, struct isea_scratch *s");
+                }
+                i = end;
+            }
+
+            for (std::size_t b = 0; b < bodies.size(); b++)
+            {
+                for (std::size_t i = bodies[b].first + 1; i < bodies[b].second; i++)
+                {
+                    std::string& line = lines[i];
+                    boost::replace_all(line, "g->triangle", "s->triangle");
+                    boost::replace_all(line, "g->quad", "s->quad");
+                    boost::replace_all(line, "g->serial", "s->serial");
+                    BOOST_FOREACH(std::string const& f, functions)
+                    {
+                        boost::replace_all(line, f + "(g, ", f + "(g, s, ");
+                    }
+                }
+            }
+        }
+
         projection_properties& m_prop;
 };
 
@@ -30,14 +30,20 @@ class converter_cpp_bg_ob_tran : public converter_cpp_bg_default
 
         void convert()
         {
-            // ob_tran is a projection forwarding to another projection
-            m_prop.template_struct = "<Geographic, Cartesian>";
+            // ob_tran is a projection forwarding to another projection.
+            // Its type (Link) is a template parameter. By default it is created
+            // at runtime by the factory. If it is known at compile time, it is
+            // stored by value and called without virtual calls. Its name must
+            // then match o_proj of the definition.
+            m_prop.template_struct = "<Link>";
+            m_prop.link_type = "boost::shared_ptr<projection<Geographic, Cartesian> >";
             m_prop.forward_declarations = "template <typename Geographic, typename Cartesian, typename Parameters> class factory;";
+            m_prop.parstruct_first = false;
 
             m_prop.setup_return_type = "double";
             m_prop.setup_extra_parameters = ", bool create = true";
 
-            m_prop.setup_extra_code.push_back("detail::ob_tran::par_ob_tran<Geographic, Cartesian> proj_parm;");
+            m_prop.setup_extra_code.push_back("detail::ob_tran::par_ob_tran<" + m_prop.link_type + " > proj_parm;");
             m_prop.setup_extra_code.push_back("Parameters p = par;");
             m_prop.setup_extra_code.push_back("double phip = setup_ob_tran(p, proj_parm, false);");
             m_prop.setup_extra_code.push_back("");
@@ -84,9 +90,7 @@ class converter_cpp_bg_ob_tran : public converter_cpp_bg_default
                         piece.push_back("");
                         piece.push_back(tab1 + "if (create)");
                         piece.push_back(tab1 + "{");
-                        piece.push_back(tab2 + "factory<Geographic, Cartesian, Parameters> fac;");
-                        piece.push_back(tab2 + "proj_parm.link.reset(fac.create_new(pj));");
-                        piece.push_back(tab2 + "if (! proj_parm.link.get()) throw proj_exception(-26);");
+                        piece.push_back(tab2 + "proj_parm.link.create(pj);");
                         // closing curly brace is already there
 
                         // Replace the original expression with this piece
@@ -124,6 +128,7 @@ class converter_cpp_bg_ob_tran : public converter_cpp_bg_default
                 BOOST_FOREACH(std::string& line, proj.lines)
                 {
                     boost::replace_all(line, ", this->m_proj_parm.link", "");
+                    boost::replace_all(line, "m_proj_parm.link->", "m_proj_parm.link.");
 
                     std::string s = boost::trim_copy(line);
                     if (boost::starts_with(s, "lp ="))
@@ -143,12 +148,97 @@ class converter_cpp_bg_ob_tran : public converter_cpp_bg_default
 
             BOOST_FOREACH(std::string& line, m_prop.proj_parameters)
             {
-                boost::replace_all(line, "struct PJconsts *", "boost::shared_ptr<projection<Geographic, Cartesian> > ");
+                boost::replace_all(line, "struct PJconsts *", "ob_tran_link<Link> ");
             }
+
+            add_link();
         }
 
     private :
 
+        void add_link()
+        {
+            std::vector<std::string>& f = m_prop.inlined_functions;
+
+            f.push_back("// Projection to be transformed, its type is known at compile time,");
+            f.push_back("// it is stored by value and called directly");
+            f.push_back("template <typename Link>");
+            f.push_back("struct ob_tran_link");
+            f.push_back("{");
+            f.push_back(tab1 + "template <typename Parameters>");
+            f.push_back(tab1 + "inline void create(Parameters const& pj)");
+            f.push_back(tab1 + "{");
+            f.push_back(tab2 + "// The definition (o_proj) must name the projection of the Link type");
+            f.push_back(tab2 + "if (pj.name != Link::traits::name()) throw proj_exception(-5);");
+            f.push_back(tab2 + "m_link = boost::in_place(pj);");
+            f.push_back(tab1 + "}");
+            f.push_back("");
+            add_link_forwarding(false);
+            f.push_back("");
+            f.push_back(tab1 + "boost::optional<Link> m_link;");
+            f.push_back("};");
+            f.push_back("");
+
+            f.push_back("// Projection to be transformed, created at runtime by the factory");
+            f.push_back("template <typename Geographic, typename Cartesian>");
+            f.push_back("struct ob_tran_link<" + m_prop.link_type + " >");
+            f.push_back("{");
+            f.push_back(tab1 + "template <typename Parameters>");
+            f.push_back(tab1 + "inline void create(Parameters const& pj)");
+            f.push_back(tab1 + "{");
+            f.push_back(tab2 + "factory<Geographic, Cartesian, Parameters> fac;");
+            f.push_back(tab2 + "m_link.reset(fac.create_new(pj));");
+            f.push_back(tab2 + "if (! m_link.get()) throw proj_exception(-26);");
+            f.push_back(tab1 + "}");
+            f.push_back("");
+            add_link_forwarding(true);
+            f.push_back("");
+            f.push_back(tab1 + m_prop.link_type + " m_link;");
+            f.push_back("};");
+        }
+
+        // Forwards fwd/inv of any coordinate type (e.g. float). The link
+        // created by the factory takes doubles, a Link known at compile time
+        // converts to its own calculation type
+        void add_link_forwarding(bool dynamic)
+        {
+            std::vector<std::string>& f = m_prop.inlined_functions;
+
+            f.push_back(tab1 + "template <typename T>");
+            f.push_back(tab1 + "inline void fwd(T& lp_lon, T& lp_lat, T& xy_x, T& xy_y) const");
+            f.push_back(tab1 + "{");
+            add_link_call(f, dynamic, "fwd", "lp_lon, lp_lat, xy_x, xy_y");
+            f.push_back(tab1 + "}");
+            f.push_back("");
+            f.push_back(tab1 + "template <typename T>");
+            f.push_back(tab1 + "inline void inv(T& xy_x, T& xy_y, T& lp_lon, T& lp_lat) const");
+            f.push_back(tab1 + "{");
+            add_link_call(f, dynamic, "inv", "xy_x, xy_y, lp_lon, lp_lat");
+            f.push_back(tab1 + "}");
+        }
+
+        static void add_link_call(std::vector<std::string>& f, bool dynamic,
+                    std::string const& method, std::string const& arguments)
+        {
+            if (! dynamic)
+            {
+                f.push_back(tab2 + "m_link->" + method + "(" + arguments + ");");
+                return;
+            }
+            std::vector<std::string> names;
+            boost::split(names, arguments, boost::is_any_of(", "), boost::token_compress_on);
+            f.push_back(tab2 + "double " + names[0] + "_d = " + names[0] + ", "
+                + names[1] + "_d = " + names[1] + ", "
+                + names[2] + "_d = " + names[2] + ", "
+                + names[3] + "_d = " + names[3] + ";");
+            f.push_back(tab2 + "m_link->" + method + "(" + names[0] + "_d, " + names[1] + "_d, "
+                + names[2] + "_d, " + names[3] + "_d);");
+            BOOST_FOREACH(std::string const& name, names)
+            {
+                f.push_back(tab2 + name + " = T(" + name + "_d);");
+            }
+        }
+
         projection_properties& m_prop;
 };
 
@@ -14,6 +14,12 @@
 #include "tissot_util.hpp"
 #include "converter_base.hpp"
 
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+
 
 namespace boost { namespace geometry { namespace proj4converter
 {
@@ -31,46 +37,248 @@ class converter_cpp_bg_robin : public converter_cpp_bg_default
         {
             m_prop.extra_impl_includes.insert("function_overloads.hpp");
 
-            // Replace two macro's by inline functions (below)
-            // They have to be replaced because V is used in Boost Macro's
+            // The two macro's V and DV are written as constexpr inline
+            // functions by the writer (they cannot stay macro's because
+            // V is used in Boost Macro's). The tables are written as
+            // structure of arrays, so V and DV get the index
+            BOOST_FOREACH(macro_or_const& macro, m_prop.defined_macros)
+            {
+                if (boost::starts_with(macro.name, "V(")
+                    || boost::starts_with(macro.name, "DV("))
+                {
+                    boost::replace_first(macro.name, "(C,", "(C,i,");
+                    for (int c = 0; c < 4; c++)
+                    {
+                        std::string const member = "C.c" + boost::lexical_cast<std::string>(c);
+                        boost::replace_all(macro.value, member, member + "[i]");
+                    }
+                }
+            }
+
+            convert_tables(m_prop.inlined_functions);
 
-            if (m_prop.defined_macros.size() == 2u)
+            bool const seed = m_prop.options.count("inverse-seed") > 0;
+            if (seed)
             {
-                m_prop.defined_macros.clear();
+                add_inverse_seed(m_prop.inlined_functions);
             }
 
-//            functor_equals_in_define eq("V(C,z)", "DV(C,z)");
+            BOOST_FOREACH(projection& proj, m_prop.projections)
+            {
+                std::vector<std::string>& lines = proj.lines;
+
+                // The row is not copied anymore, its c0 is subtracted in the Newton-Raphson loop
+                functor_trimmed_equals functor("struct COEFS T;", "T = Y[i];");
+                functor.add("T.c0 -= lp_lat;").add("/* make into root */");
+                lines.erase
+                    (
+                        std::remove_if(lines.begin(), lines.end(), functor),
+                        lines.end()
+                    );
+
+                for (std::vector<std::string>::iterator it = lines.begin(); it != lines.end(); ++it)
+                {
+                    std::string& line = *it;
+                    boost::replace_all(line, "floor", "int_floor");
+
+                    boost::replace_all(line, "DV(T,t)", "DV(Y, i, t)");
+                    boost::replace_all(line, "V(T,t)", "(V(Y, i, t) - lp_lat)");
+                    boost::replace_all(line, "T.c0", "Y.c0[i]");
+                    boost::replace_all(line, "Y[i].c0", "Y.c0[i]");
+                    boost::replace_all(line, "Y[i+1].c0", "Y.c0[i+1]");
+                    boost::replace_all(line, "X[NODES].c0", "X.c0[NODES]");
+                    boost::replace_all(line, "V(X[i], ", "V(X, i, ");
+                    boost::replace_all(line, "V(Y[i], ", "V(Y, i, ");
+                }
 
-//            m_prop.defined_consts.erase
-//                (
-//                    std::remove_if(m_prop.defined_consts.begin(),
-//                        m_prop.defined_consts.end(),eq),
-//                    m_prop.defined_consts.end()
-//                );
+                if (proj.direction == "inverse")
+                {
+                    if (seed)
+                    {
+                        seed_first_guess(lines);
+                    }
+                    bound_newton_raphson(lines);
+                }
+            }
 
+            // Iteration cap of the bounded Newton-Raphson loop
+            macro_or_const max_iter;
+            max_iter.type = "int";
+            max_iter.name = "MAX_ITER";
+            max_iter.value = "10";
+            m_prop.defined_consts.push_back(max_iter);
+        }
 
+    private :
 
-            BOOST_FOREACH(std::string& line, m_prop.inlined_functions)
+        // Replaces the linear interpolation of the first guess by the
+        // inverse series of the interval
+        static void seed_first_guess(std::vector<std::string>& lines)
+        {
+            for (std::vector<std::string>::iterator it = lines.begin(); it != lines.end(); ++it)
             {
-                boost::replace_all(line, "float c0", "double c0");
+                std::string nospace = *it;
+                boost::erase_all(nospace, " ");
+                if (boost::starts_with(nospace, "t=")
+                    && boost::contains(nospace, "(lp_lat-Y.c0[i])/(Y.c0[i+1]-Y.c0[i]);"))
+                {
+                    std::string const indent = it->substr(0, it->find_first_not_of(' '));
+                    if (it != lines.begin() && boost::contains(*(it - 1), "first guess"))
+                    {
+                        *(it - 1) = indent + "/* first guess, inverse series of the interval */";
+                    }
+                    *it = indent + "t = lp_lat - Y.c0[i];";
+                    lines.insert(it + 1, indent + "t *= IY.a1[i] + t * (IY.a2[i] + t * IY.a3[i]);");
+                    return;
+                }
             }
-            BOOST_FOREACH(projection& proj, m_prop.projections)
+            throw std::runtime_error("robin: first guess (t = ...) not found, cannot seed the inverse");
+        }
+
+        // Caps the Newton-Raphson loop, which does not converge
+        // for latitudes outside the table
+        static void bound_newton_raphson(std::vector<std::string>& lines)
+        {
+            for (std::vector<std::string>::iterator it = lines.begin(); it != lines.end(); ++it)
             {
-                BOOST_FOREACH(std::string& line, proj.lines)
+                if (boost::starts_with(boost::trim_copy(*it), "for (;;) { /* Newton-Raphson"))
                 {
-                    boost::replace_all(line, "floor", "int_floor");
+                    std::string const indent = it->substr(0, it->find_first_not_of(' '));
+                    boost::replace_first(*it, "for (;;) {", "for (iter = MAX_ITER; iter ; --iter) {");
+                    it = lines.insert(it, indent + "int iter;") + 1;
+                    for (++it; it != lines.end() && boost::trim_copy(*it) != "}"; ++it)
+                    {
+                    }
+                    if (it == lines.end())
+                    {
+                        break;
+                    }
+                    lines.insert(it + 1, indent + "if (!iter) throw proj_exception();");
+                    return;
                 }
-                if (proj.direction == "forward")
+            }
+            throw std::runtime_error("robin: Newton-Raphson loop (for (;;)) not found, cannot bound it");
+        }
+
+        // Converts the array of structs (X and Y) to a cache line aligned
+        // struct of arrays, such that the polynomials can be vectorized
+        void convert_tables(std::vector<std::string>& lines)
+        {
+            std::vector<std::string> result;
+            for (std::vector<std::string>::const_iterator it = lines.begin(); it != lines.end(); ++it)
+            {
+                std::string const trimmed = boost::trim_copy(*it);
+                if (trimmed == "struct COEFS {")
+                {
+                    result.push_back("struct BOOST_ALIGNMENT(64) COEFS {");
+                    for (int c = 0; c < 4; c++)
+                    {
+                        result.push_back(tab1 + "double c" + boost::lexical_cast<std::string>(c) + "[NODES + 1];");
+                    }
+                    // Skip original members
+                    while (it != lines.end() && boost::trim_copy(*it) != "};")
+                    {
+                        ++it;
+                    }
+                    result.push_back("};");
+                }
+                else if (boost::starts_with(trimmed, "static const struct COEFS ")
+                    && boost::ends_with(trimmed, "[] = {"))
+                {
+                    std::string const name = trimmed.substr(26, trimmed.find('[') - 26);
+                    std::vector<std::vector<std::string> > rows;
+                    for (++it; it != lines.end() && boost::trim_copy(*it) != "};"; ++it)
+                    {
+                        std::vector<std::string> row;
+                        split(*it, row, "{}, ");
+                        if (row.size() == 4)
+                        {
+                            rows.push_back(row);
+                        }
+                    }
+                    if (name == "Y")
+                    {
+                        m_y = rows;
+                    }
+                    write_table("COEFS", name, "c", 0, rows, result);
+                }
+                else
                 {
-                    proj.preceding_lines.push_back("inline double  V(COEFS const& C, double z) const");
-                    proj.preceding_lines.push_back("{ return (C.c0 + z * (C.c1 + z * (C.c2 + z * C.c3))); }");
-                    proj.preceding_lines.push_back("inline double DV(COEFS const& C, double z) const");
-                    proj.preceding_lines.push_back("{ return (C.c1 + z * (C.c2 + C.c2 + z * 3. * C.c3)); }");
+                    result.push_back(*it);
+                }
+                if (it == lines.end())
+                {
+                    break;
                 }
             }
+            lines = result;
         }
 
-    private :
+        // Adds the series reversion of the cubic polynomials of Y, per interval.
+        // With d = y - c0, t = a1 d + a2 d^2 + a3 d^3 approximates the root,
+        // such that Newton-Raphson needs (nearly) no iterations
+        void add_inverse_seed(std::vector<std::string>& lines)
+        {
+            std::vector<std::vector<std::string> > rows;
+            BOOST_FOREACH(std::vector<std::string> const& row, m_y)
+            {
+                double const c1 = atof(row[1].c_str());
+                double const c2 = atof(row[2].c_str());
+                double const c3 = atof(row[3].c_str());
+
+                std::vector<std::string> inv(4);
+                inv[1] = to_string(1.0 / c1);
+                inv[2] = to_string(-c2 / (c1 * c1 * c1));
+                inv[3] = to_string((2.0 * c2 * c2 - c1 * c3) / (c1 * c1 * c1 * c1 * c1));
+                rows.push_back(inv);
+            }
+
+            lines.push_back("");
+            lines.push_back("/* inverse series of Y per interval, seeding Newton-Raphson */");
+            lines.push_back("struct BOOST_ALIGNMENT(64) INV_COEFS {");
+            for (int c = 1; c < 4; c++)
+            {
+                lines.push_back(tab1 + "double a" + boost::lexical_cast<std::string>(c) + "[NODES + 1];");
+            }
+            lines.push_back("};");
+            write_table("INV_COEFS", "IY", "a", 1, rows, lines);
+        }
+
+        static std::string to_string(double value)
+        {
+            std::ostringstream out;
+            out.precision(12);
+            out << value;
+            return out.str();
+        }
+
+        static void write_table(std::string const& type, std::string const& name,
+                    std::string const& member, int first,
+                    std::vector<std::vector<std::string> > const& rows,
+                    std::vector<std::string>& lines)
+        {
+            std::size_t const per_line = 6;
+            lines.push_back("static const " + type + " " + name + " = {");
+            for (int c = first; c < 4; c++)
+            {
+                std::string line = tab1 + "{";
+                for (std::size_t i = 0; i < rows.size(); i++)
+                {
+                    if (i > 0 && i % per_line == 0)
+                    {
+                        lines.push_back(boost::trim_right_copy(line));
+                        line = tab1 + " ";
+                    }
+                    line += rows[i][c] + (i + 1 < rows.size() ? ", " : "");
+                }
+                line += std::string("}") + (c < 3 ? "," : "") + " // "
+                    + member + boost::lexical_cast<std::string>(c);
+                lines.push_back(line);
+            }
+            lines.push_back("};");
+        }
+
+        std::vector<std::vector<std::string> > m_y;
 
         projection_properties& m_prop;
 };
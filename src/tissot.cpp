@@ -7,6 +7,7 @@
 // Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <set>
 #include <string>
 
 #include "tissot_util.hpp"
@@ -15,6 +16,10 @@
 #include "tissot_converter.hpp"
 #include "tissot_summary_writer.hpp"
 #include "tissot_bg_writer.hpp"
+#include "tissot_precision_writer.hpp"
+#include "tissot_benchmark_writer.hpp"
+#include "tissot_epsg_writer.hpp"
+#include "tissot_compare_writer.hpp"
 
 #include "analyzer.hpp"
 #include "documenter.hpp"
@@ -98,7 +103,17 @@ int main (int argc, char** argv)
 
     if (argc < 3)
     {
-        std::cerr << "USAGE: " << argv[0] << " <source file> <group name>" << std::endl;
+        std::cerr << "USAGE: " << argv[0] << " <source file> <group name> [--option ...]" << std::endl
+            << "Options:" << std::endl
+            << "  --inverse-seed   seed the inverse iteration with a precomputed table (robin)" << std::endl
+            << "  --unroll-series  unroll the Clenshaw summations using fma (etmerc)" << std::endl
+            << "  --precision-report  write a program comparing float and double instead" << std::endl
+            << "  --benchmark      write a program timing forward and inverse instead" << std::endl
+            << "  --epsg-harness   write a program round tripping the EPSG definitions instead" << std::endl
+            << "  --compare-proj4  write a program comparing with proj4 instead" << std::endl
+            << "  --split          include the declarations from <group>_fwd.hpp" << std::endl
+            << "  --declarations   write the declarations (<group>_fwd.hpp) instead" << std::endl
+            << "  --instantiations write explicit instantiations (<group>.cpp) instead" << std::endl;
         return 1;
     }
 
@@ -106,6 +121,28 @@ int main (int argc, char** argv)
     std::string projection_group(argv[2]);
     projection_properties projprop;
 
+    // The options listed in the usage, a misspelled one is not silently ignored
+    std::string const known[] = { "inverse-seed", "unroll-series", "precision-report",
+        "benchmark", "epsg-harness", "compare-proj4", "split", "declarations",
+        "instantiations" };
+    std::set<std::string> const known_options(boost::begin(known), boost::end(known));
+
+    for (int i = 3; i < argc; i++)
+    {
+        std::string option(argv[i]);
+        if (! boost::starts_with(option, "--"))
+        {
+            std::cerr << "Unknown argument: " << option << std::endl;
+            return 1;
+        }
+        if (known_options.count(option.substr(2)) == 0)
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+        projprop.options.insert(option.substr(2));
+    }
+
     try
     {
         std::cerr << "Convert " << projection_group << std::endl;
@@ -127,14 +164,43 @@ int main (int argc, char** argv)
         converter.trim();
         converter.scan();
 
+        for (std::map<std::string, int>::const_iterator it = projprop.report.begin();
+            it != projprop.report.end(); ++it)
+        {
+            std::cerr << projection_group << ": " << it->first << ": " << it->second << std::endl;
+        }
+
         // Afer parsing and possible modifications of specific converters:
         documenter.create();
 
         delete specific_converter;
 
-        proj4_writer_cpp_bg writer(projprop, projection_group, epsg_entries, std::cout);
-//        proj4_summary_writer writer(projprop, projection_group, std::cout);
-        writer.write();
+        if (projprop.options.count("precision-report") > 0)
+        {
+            proj4_precision_writer writer(projprop, projection_group, std::cout);
+            writer.write();
+        }
+        else if (projprop.options.count("benchmark") > 0)
+        {
+            proj4_benchmark_writer writer(projprop, projection_group, std::cout);
+            writer.write();
+        }
+        else if (projprop.options.count("epsg-harness") > 0)
+        {
+            proj4_epsg_writer writer(projprop, projection_group, epsg_entries, std::cout);
+            writer.write();
+        }
+        else if (projprop.options.count("compare-proj4") > 0)
+        {
+            proj4_compare_writer writer(projprop, projection_group, std::cout);
+            writer.write();
+        }
+        else
+        {
+            proj4_writer_cpp_bg writer(projprop, projection_group, epsg_entries, std::cout);
+//            proj4_summary_writer writer(projprop, projection_group, std::cout);
+            writer.write();
+        }
     }
     catch(std::exception const& e)
     {
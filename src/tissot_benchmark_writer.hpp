@@ -0,0 +1,328 @@
+#ifndef TISSOT_BENCHMARK_WRITER_HPP
+#define TISSOT_BENCHMARK_WRITER_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/foreach.hpp>
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Returns the name of the class of the projection and model
+inline std::string benchmark_class_name(derived const& der, model const& mod,
+            std::string const& group)
+{
+    return mod.subgroup != group
+        ? mod.subgroup + "_" + mod.name
+        : der.name + "_" + mod.name;
+}
+
+// Returns the grid (lon_min, lon_max, lat_min, lat_max, step) in the domain
+// of the projection, avoiding poles and antimeridian
+inline std::string benchmark_grid(derived const& der)
+{
+    std::vector<std::string> const& ch = der.parsed_characteristics;
+    if (boost::icontains(der.description, "transverse"))
+    {
+        return "{ -10, 10, -80, 80, 1 }";
+    }
+    else if (std::find(ch.begin(), ch.end(), "Azimuthal") != ch.end()
+        || std::find(ch.begin(), ch.end(), "Azimuthal (mod)") != ch.end())
+    {
+        return "{ -60, 60, -60, 60, 2 }";
+    }
+    else if (std::find(ch.begin(), ch.end(), "Cylindrical") != ch.end())
+    {
+        return "{ -175, 175, -80, 80, 5 }";
+    }
+    return "{ -175, 175, -85, 85, 5 }";
+}
+
+// Returns the definition selecting the projection and model, with defaults
+// for conics, which require standard parallels
+inline std::string benchmark_definition(derived const& der, model const& mod)
+{
+    std::string result = "+proj=" + der.name + " "
+        + (mod.name == "spheroid" ? "+R=6370997"
+            : mod.name == "guam" ? "+ellps=clrk66 +guam"
+            : mod.name == "oblique" ? "+R=6370997 +o_proj=eqc +o_lat_p=45"
+            : mod.name == "transverse" ? "+R=6370997 +o_proj=eqc +o_lat_p=0"
+            : "+ellps=WGS84");
+    BOOST_FOREACH(parameter const& p, der.parsed_parameters)
+    {
+        if (p.name == "lat_1")
+        {
+            result += " +lat_1=30";
+        }
+        else if (p.name == "lat_2")
+        {
+            result += " +lat_2=60";
+        }
+    }
+    return result;
+}
+
+
+// Writes a program timing forward and inverse of each projection and model,
+// on a grid suited to the projection, reporting CSV in nanoseconds per point
+class proj4_benchmark_writer
+{
+    public :
+        proj4_benchmark_writer(projection_properties& projpar
+                , std::string const& group
+                , std::ostream& str)
+            : m_prop(projpar)
+            , stream(str)
+            , projection_group(group)
+        {
+        }
+
+        void write()
+        {
+            write_header();
+            write_functions();
+
+            stream
+                << "int main(int argc, char** argv)" << std::endl
+                << "{" << std::endl
+                << tab1 << "// Extra parameters (e.g. +lat_0=45) can be passed on the command line" << std::endl
+                << tab1 << "std::string extra;" << std::endl
+                << tab1 << "bool header = true;" << std::endl
+                << tab1 << "for (int i = 1; i < argc; i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "if (std::string(argv[i]) == \"--no-header\")" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "header = false;" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "else" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "extra += std::string(\" \") + argv[i];" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "if (header)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cout << \"group,projection,model,direction,points,ns_per_point\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl;
+
+            if (! m_prop.valid)
+            {
+                stream << tab1 << "// " << projection_group << " is not converted" << std::endl;
+            }
+            else
+            {
+                BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+                {
+                    BOOST_FOREACH(model const& mod, der.models)
+                    {
+                        write_report(der, mod);
+                    }
+                }
+            }
+
+            stream
+                << tab1 << "return 0;" << std::endl
+                << "}" << std::endl;
+        }
+
+    private :
+
+        void write_header()
+        {
+            stream
+                << "// Timing of forward and inverse of " << projection_group
+                << ", in nanoseconds per point" << std::endl
+                << "// Generated by tissot, compile it with optimization against the generated projection" << std::endl
+                << std::endl
+                << "#include <cmath>" << std::endl
+                << "#include <ctime>" << std::endl
+                << "#include <iostream>" << std::endl
+                << "#include <string>" << std::endl
+                << "#include <vector>" << std::endl
+                << std::endl
+                << "#include <boost/geometry.hpp>" << std::endl
+                << include_projections << "/parameters.hpp>" << std::endl;
+            if (! m_prop.link_type.empty())
+            {
+                // The default link is created by the factory
+                stream << include_projections << "/factory.hpp>" << std::endl;
+            }
+            stream
+                << include_projections << "/proj/" << projection_group << ".hpp>" << std::endl
+                << std::endl
+                << "namespace bg = boost::geometry;" << std::endl
+                << "namespace bgp = boost::geometry::projections;" << std::endl
+                << std::endl
+                << "typedef bg::model::point<double, 2, bg::cs::cartesian> point_type;" << std::endl
+                << std::endl
+                << "// Area, in degrees, of the grid" << std::endl
+                << "struct grid_type" << std::endl
+                << "{" << std::endl
+                << tab1 << "double lon_min, lon_max, lat_min, lat_max, step;" << std::endl
+                << "};" << std::endl
+                << std::endl;
+        }
+
+        void write_functions()
+        {
+            stream
+                << "struct call_forward" << std::endl
+                << "{" << std::endl
+                << tab1 << "template <typename Prj>" << std::endl
+                << tab1 << "void operator()(Prj const& prj, point_type const& p, point_type& q) const" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "prj.forward(p, q);" << std::endl
+                << tab1 << "}" << std::endl
+                << "};" << std::endl
+                << std::endl
+                << "struct call_inverse" << std::endl
+                << "{" << std::endl
+                << tab1 << "template <typename Prj>" << std::endl
+                << tab1 << "void operator()(Prj const& prj, point_type const& p, point_type& q) const" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "prj.inverse(p, q);" << std::endl
+                << tab1 << "}" << std::endl
+                << "};" << std::endl
+                << std::endl
+                << "// Returns the grid points (input) for which the call succeeds," << std::endl
+                << "// and their results (output)" << std::endl
+                << "template <typename Prj, typename Call>" << std::endl
+                << "void valid_points(Prj const& prj, std::vector<point_type> const& points," << std::endl
+                << tab1 << "std::vector<point_type>& input, std::vector<point_type>& output, Call const& call)" << std::endl
+                << "{" << std::endl
+                << tab1 << "for (std::size_t i = 0; i < points.size(); i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "point_type result;" << std::endl
+                << tab2 << "try" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "call(prj, points[i], result);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "continue;" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "double const x = bg::get<0>(result);" << std::endl
+                << tab2 << "double const y = bg::get<1>(result);" << std::endl
+                << tab2 << "if (x == x && y == y && std::fabs(x) < 1.0e30 && std::fabs(y) < 1.0e30)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "input.push_back(points[i]);" << std::endl
+                << tab3 << "output.push_back(result);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "// Returns the nanoseconds per point, repeating the calls for at least 0.2 seconds" << std::endl
+                << "template <typename Prj, typename Call>" << std::endl
+                << "double time_points(Prj const& prj, std::vector<point_type> const& points, Call const& call)" << std::endl
+                << "{" << std::endl
+                << tab1 << "if (points.empty())" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "return 0.0;" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "volatile double sink = 0.0;" << std::endl
+                << tab1 << "long repetitions = 0;" << std::endl
+                << tab1 << "std::clock_t const start = std::clock();" << std::endl
+                << tab1 << "std::clock_t elapsed = 0;" << std::endl
+                << tab1 << "do" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (std::size_t i = 0; i < points.size(); i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "point_type result;" << std::endl
+                << tab3 << "call(prj, points[i], result);" << std::endl
+                << tab3 << "sink = sink + bg::get<0>(result);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "repetitions++;" << std::endl
+                << tab2 << "elapsed = std::clock() - start;" << std::endl
+                << tab1 << "} while (elapsed < CLOCKS_PER_SEC / 5);" << std::endl
+                << tab1 << "return 1.0e9 * elapsed / CLOCKS_PER_SEC / (double(repetitions) * points.size());" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "std::vector<point_type> create_grid(grid_type const& grid)" << std::endl
+                << "{" << std::endl
+                << tab1 << "double const d2r = bg::math::d2r<double>();" << std::endl
+                << tab1 << "int const nlon = int((grid.lon_max - grid.lon_min) / grid.step + 0.5);" << std::endl
+                << tab1 << "int const nlat = int((grid.lat_max - grid.lat_min) / grid.step + 0.5);" << std::endl
+                << tab1 << "std::vector<point_type> result;" << std::endl
+                << tab1 << "for (int j = 0; j <= nlat; j++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (int i = 0; i <= nlon; i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "result.push_back(point_type((grid.lon_min + i * grid.step) * d2r," << std::endl
+                << tab3 << "    (grid.lat_min + j * grid.step) * d2r));" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "return result;" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "template <typename Prj>" << std::endl
+                << "void report_forward(std::string const& prefix, Prj const& prj," << std::endl
+                << tab1 << "std::vector<point_type> const& grid," << std::endl
+                << tab1 << "std::vector<point_type>& lls, std::vector<point_type>& xys)" << std::endl
+                << "{" << std::endl
+                << tab1 << "valid_points(prj, grid, lls, xys, call_forward());" << std::endl
+                << tab1 << "std::cout << prefix << \",forward,\" << lls.size() << \",\"" << std::endl
+                << tab1 << "    << time_points(prj, lls, call_forward()) << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "template <typename Prj>" << std::endl
+                << "void report_inverse(std::string const& prefix, Prj const& prj," << std::endl
+                << tab1 << "std::vector<point_type> const& xys)" << std::endl
+                << "{" << std::endl
+                << tab1 << "std::vector<point_type> input, output;" << std::endl
+                << tab1 << "valid_points(prj, xys, input, output, call_inverse());" << std::endl
+                << tab1 << "std::cout << prefix << \",inverse,\" << input.size() << \",\"" << std::endl
+                << tab1 << "    << time_points(prj, input, call_inverse()) << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl;
+        }
+
+        void write_report(derived const& der, model const& mod)
+        {
+            std::string const name = benchmark_class_name(der, mod, projection_group);
+
+            // Projections requiring other parameters throw if they are not passed
+            stream
+                << tab1 << "try" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "grid_type const grid = " << benchmark_grid(der) << ";" << std::endl
+                << tab2 << "bgp::parameters const par = bgp::init(\""
+                << benchmark_definition(der, mod) << "\" + extra);" << std::endl
+                << tab2 << "bgp::" << name << "<point_type, point_type> const prj(par);" << std::endl
+                << tab2 << "std::vector<point_type> lls, xys;" << std::endl
+                << tab2 << "report_forward(\"" << projection_group << "," << der.name << "," << mod.name
+                << "\", prj, create_grid(grid), lls, xys);" << std::endl;
+            if (mod.has_inverse)
+            {
+                stream
+                    << tab2 << "report_inverse(\"" << projection_group << "," << der.name << "," << mod.name
+                    << "\", prj, xys);" << std::endl;
+            }
+            stream
+                << tab1 << "}" << std::endl
+                << tab1 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cerr << \"" << name << ": not initialized, pass its parameters\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl;
+        }
+
+        projection_properties& m_prop;
+        std::ostream& stream;
+        std::string projection_group;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_BENCHMARK_WRITER_HPP
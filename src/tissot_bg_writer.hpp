@@ -31,11 +31,23 @@ class proj4_writer_cpp_bg
             , m_epsg_entries(epsg_entries)
             , projection_group(group)
             , hpp("BOOST_GEOMETRY_PROJECTIONS_" + boost::to_upper_copy(projection_group) + "_HPP")
+            , m_split(projpar.options.count("split") > 0)
         {
         }
 
         void write()
         {
+            if (m_projpar.options.count("declarations") > 0)
+            {
+                write_declarations();
+                return;
+            }
+            if (m_projpar.options.count("instantiations") > 0)
+            {
+                write_instantiations();
+                return;
+            }
+
             stream << "#ifndef " << hpp << std::endl
                 << "#define " << hpp << std::endl
                 << std::endl;
@@ -62,8 +74,13 @@ class proj4_writer_cpp_bg
             write_end_impl();
 
             write_classes();
+            write_grid_traits();
 
             write_wrappers();
+            if (m_split)
+            {
+                write_extern_instantiations();
+            }
             write_end();
         }
 
@@ -120,6 +137,14 @@ class proj4_writer_cpp_bg
             }
             write_endl_if_filled(m_projpar.extra_includes);
 
+            if (m_split)
+            {
+                // The declarations contain the default template arguments
+                stream << include_projections << "/proj/" << projection_group << "_fwd.hpp>" << std::endl
+                    << extern_instantiations_condition() << std::endl;
+                write_instantiation_includes(stream);
+                stream << "#endif" << std::endl;
+            }
             stream
                 << include_projections << "/impl/base_static.hpp>" << std::endl
                 << include_projections << "/impl/base_dynamic.hpp>" << std::endl
@@ -142,6 +167,7 @@ class proj4_writer_cpp_bg
             {
                 stream << std::endl;
                 stream << include_projections << "/epsg_traits.hpp>" << std::endl;
+                stream << include_projections << "/parameters.hpp>" << std::endl;
             }
 
             stream << std::endl;
@@ -155,6 +181,134 @@ class proj4_writer_cpp_bg
             }
         }
 
+        // Writes the scale factors of a projection class at a point, and
+        // of a series of points (e.g. a grid), calculated analytically by
+        // spc() if the projection has it, and numerically otherwise
+        void write_factors_methods(bool analytic)
+        {
+            stream
+                << std::endl
+                << tab4 << "// Scale factors at a point, in radians, the longitude relative to the central meridian" << std::endl
+                << tab4 << "inline void fac(geographic_type lp_lon, geographic_type lp_lat, factors<CalculationType>& result) const" << std::endl
+                << tab4 << "{" << std::endl
+                << tab5 << "geographic_type const h = factors_step<CalculationType>();" << std::endl
+                << tab5 << "lp_lat = factors_latitude(lp_lat, h);" << std::endl
+                << tab5 << "result = factors<CalculationType>();" << std::endl;
+            if (analytic)
+            {
+                stream << tab5 << "spc(lp_lon, lp_lat, result);" << std::endl;
+            }
+            stream
+                << tab5 << "complete_factors(*this, lp_lon, lp_lat, h," << std::endl
+                << tab5 << tab1 << "geographic_type(this->m_par.es), geographic_type(this->m_par.one_es), result);" << std::endl
+                << tab4 << "}" << std::endl
+                << std::endl
+                << tab4 << "// Scale factors at count points" << std::endl
+                << tab4 << "inline void fac(geographic_type const* lp_lon, geographic_type const* lp_lat," << std::endl
+                << tab5 << "std::size_t count, factors<CalculationType>* result) const" << std::endl
+                << tab4 << "{" << std::endl
+                << tab5 << "for (std::size_t i = 0; i < count; i++)" << std::endl
+                << tab5 << "{" << std::endl
+                << tab5 << tab1 << "fac(lp_lon[i], lp_lat[i], result[i]);" << std::endl
+                << tab5 << "}" << std::endl
+                << tab4 << "}" << std::endl;
+        }
+
+        // Writes the forward of a row of points at the same latitude, if part
+        // of the forward depends on the latitude only, and the forward of a
+        // grid: by two rows of forward calls if it is separable, by rows,
+        // or per point
+        void write_grid_methods(projection const& proj)
+        {
+            if (! proj.row_lines.empty())
+            {
+                stream
+                    << std::endl
+                    << tab4 << "// Forward of count points at the same latitude, calculating what depends" << std::endl
+                    << tab4 << "// on the latitude only once" << std::endl
+                    << tab4 << "inline void fwd_row(geographic_type lp_lat, geographic_type const* row_lon, std::size_t count," << std::endl
+                    << tab5 << "cartesian_type* row_x, cartesian_type* row_y) const" << std::endl
+                    << tab4 << "{" << std::endl
+                    << tab5 << "cartesian_type xy_x = cartesian_type(), xy_y = cartesian_type();" << std::endl;
+                BOOST_FOREACH(std::string const& line, proj.row_declarations)
+                {
+                    stream << preceded(tab4, line) << std::endl;
+                }
+                BOOST_FOREACH(std::string const& line, proj.row_lines)
+                {
+                    stream << preceded(tab4, line) << std::endl;
+                }
+                stream
+                    << tab5 << "for (std::size_t row_index = 0; row_index < count; row_index++)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "geographic_type lp_lon = row_lon[row_index];" << std::endl;
+                BOOST_FOREACH(std::string const& line, proj.point_lines)
+                {
+                    stream << preceded(tab5, line) << std::endl;
+                }
+                stream
+                    << tab5 << tab1 << "row_x[row_index] = xy_x;" << std::endl
+                    << tab5 << tab1 << "row_y[row_index] = xy_y;" << std::endl
+                    << tab5 << "}" << std::endl
+                    << tab4 << "}" << std::endl;
+            }
+
+            stream
+                << std::endl
+                << tab4 << "// Forward of a grid of nlon x nlat points, in radians, the longitudes relative" << std::endl
+                << tab4 << "// to the central meridian, into grid_x and grid_y (per latitude a row of nlon)" << std::endl
+                << tab4 << "inline void fwd_grid(geographic_type const* grid_lon, std::size_t nlon," << std::endl
+                << tab5 << "geographic_type const* grid_lat, std::size_t nlat," << std::endl
+                << tab5 << "cartesian_type* grid_x, cartesian_type* grid_y) const" << std::endl
+                << tab4 << "{" << std::endl;
+            if (proj.grid == "separable")
+            {
+                stream
+                    << tab5 << "// x depends on the longitude only, y on the latitude only" << std::endl
+                    << tab5 << "if (nlon == 0 || nlat == 0)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "return;" << std::endl
+                    << tab5 << "}" << std::endl
+                    << tab5 << "for (std::size_t i = 0; i < nlon; i++)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "geographic_type lp_lon = grid_lon[i], lp_lat = grid_lat[0];" << std::endl
+                    << tab5 << tab1 << "fwd(lp_lon, lp_lat, grid_x[i], grid_y[i]);" << std::endl
+                    << tab5 << "}" << std::endl
+                    << tab5 << "for (std::size_t j = 1; j < nlat; j++)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "geographic_type lp_lon = grid_lon[0], lp_lat = grid_lat[j];" << std::endl
+                    << tab5 << tab1 << "cartesian_type xy_x, xy_y;" << std::endl
+                    << tab5 << tab1 << "fwd(lp_lon, lp_lat, xy_x, xy_y);" << std::endl
+                    << tab5 << tab1 << "for (std::size_t i = 0; i < nlon; i++)" << std::endl
+                    << tab5 << tab1 << "{" << std::endl
+                    << tab5 << tab2 << "grid_x[j * nlon + i] = grid_x[i];" << std::endl
+                    << tab5 << tab2 << "grid_y[j * nlon + i] = xy_y;" << std::endl
+                    << tab5 << tab1 << "}" << std::endl
+                    << tab5 << "}" << std::endl;
+            }
+            else if (! proj.row_lines.empty())
+            {
+                stream
+                    << tab5 << "for (std::size_t j = 0; j < nlat; j++)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "fwd_row(grid_lat[j], grid_lon, nlon, grid_x + j * nlon, grid_y + j * nlon);" << std::endl
+                    << tab5 << "}" << std::endl;
+            }
+            else
+            {
+                stream
+                    << tab5 << "for (std::size_t j = 0; j < nlat; j++)" << std::endl
+                    << tab5 << "{" << std::endl
+                    << tab5 << tab1 << "for (std::size_t i = 0; i < nlon; i++)" << std::endl
+                    << tab5 << tab1 << "{" << std::endl
+                    << tab5 << tab2 << "geographic_type lp_lon = grid_lon[i], lp_lat = grid_lat[j];" << std::endl
+                    << tab5 << tab2 << "fwd(lp_lon, lp_lat, grid_x[j * nlon + i], grid_y[j * nlon + i]);" << std::endl
+                    << tab5 << tab1 << "}" << std::endl
+                    << tab5 << "}" << std::endl;
+            }
+            stream << tab4 << "}" << std::endl;
+        }
+
         void write_begin_impl()
         {
 
@@ -171,31 +325,39 @@ class proj4_writer_cpp_bg
                 stream << tab3 << s << std::endl;
             }
             write_endl_if_filled(m_projpar.extra_structs);
-
-            std::string ts = m_projpar.template_struct;
-            if (! ts.empty())
-            {
-                stream << tab3 << "template <";
-                if (ts == "<Cartesian>")
-                {
-                    stream  << "typename Cartesian";
-                }
-                else if (ts == "<Geographic, Cartesian>")
-                {
-                    stream << "typename Geographic, typename Cartesian";
-                }
-                else if (ts == "<Geographic, Cartesian, Parameters>")
-                {
-                    stream << "typename Geographic, typename Cartesian, typename Parameters";
-                }
-                stream << ">" << std::endl;
-            }
         }
 
         void write_proj_par_struct()
         {
             if (! m_projpar.proj_parameters.empty())
             {
+                std::string ts = m_projpar.template_struct;
+                if (! ts.empty())
+                {
+                    stream << tab3 << "template <";
+                    if (ts == "<Cartesian>")
+                    {
+                        stream  << "typename Cartesian";
+                    }
+                    else if (ts == "<Geographic, Cartesian>")
+                    {
+                        stream << "typename Geographic, typename Cartesian";
+                    }
+                    else if (ts == "<Geographic, Cartesian, Parameters>")
+                    {
+                        stream << "typename Geographic, typename Cartesian, typename Parameters";
+                    }
+                    else if (ts == "<Geographic, Cartesian, Parameters, CalculationType>")
+                    {
+                        stream << "typename Geographic, typename Cartesian, typename Parameters, typename CalculationType";
+                    }
+                    else if (ts == "<Link>")
+                    {
+                        stream << "typename Link";
+                    }
+                    stream << ">" << std::endl;
+                }
+
                 stream
                     << tab3 << "struct par_" << projection_group << std::endl
                     << tab3 << "{" << std::endl;
@@ -203,18 +365,60 @@ class proj4_writer_cpp_bg
                     it != m_projpar.proj_parameters.end(); 
                     ++it)
                 {
-                    stream << tab4  << *it << std::endl;
+                    stream << preceded(tab4, *it) << std::endl;
                 }
                 stream << tab3 << "};" << std::endl << std::endl;
             }
         }
 
+        // Extra template parameter for projections forwarding to another projection
+        std::string link_parameter() const
+        {
+            if (m_projpar.link_type.empty())
+            {
+                return "";
+            }
+            // Avoid ">>" for C++03
+            return ", typename Link = " + m_projpar.link_type
+                + (boost::ends_with(m_projpar.link_type, ">") ? " " : "");
+        }
+
+        std::string link_argument() const
+        {
+            return m_projpar.link_type.empty() ? "" : ", Link";
+        }
+
+        // Extra template parameter for projections switching on their mode,
+        // a negative value means that the mode is determined at runtime
+        std::string mode_parameter(bool defaults = true) const
+        {
+            if (m_projpar.mode_values.empty())
+            {
+                return "";
+            }
+            return defaults ? ", int Mode = -1" : ", int Mode";
+        }
+
+        std::string mode_argument() const
+        {
+            return m_projpar.mode_values.empty() ? "" : ", Mode";
+        }
+
         void write_consts()
         {
+            // Constants which are literal expressions are constexpr,
+            // others (e.g. using geometry::math::pi) are static const
+            std::set<std::string> constant_names;
             BOOST_FOREACH(macro_or_const const& con, m_projpar.defined_consts)
             {
+                bool const constant = is_constant_expression(con.value, constant_names);
+                if (constant)
+                {
+                    constant_names.insert(con.name);
+                }
                 stream
-                    << tab3 << "static const " << con.type
+                    << tab3 << "static " << (constant ? "BOOST_CONSTEXPR_OR_CONST " : "const ")
+                    << con.type
                     << " " << con.name
                     << " = " << con.value
                     << ";"
@@ -224,14 +428,64 @@ class proj4_writer_cpp_bg
 
             BOOST_FOREACH(macro_or_const const& macro, m_projpar.defined_macros)
             {
-                stream
-                    << tab3 << "#define " << macro.name
-                    << " " << macro.value
-                    << std::endl;
+                if (boost::contains(macro.name, "("))
+                {
+                    write_macro_as_function(macro);
+                }
+                else
+                {
+                    // Cannot be typed, it is undefined at the end of the detail namespace
+                    stream
+                        << tab3 << "#define " << macro.name
+                        << " " << macro.value
+                        << std::endl;
+                }
             }
             write_endl_if_filled(m_projpar.defined_macros);
         }
 
+        void write_macro_as_function(macro_or_const const& macro)
+        {
+            // Converts for example "V(C,z) (C.c0 + z * C.c1)" into a
+            // templated constexpr function, each argument having its own type
+            std::string::size_type const open = macro.name.find('(');
+            std::string const name = macro.name.substr(0, open);
+            std::string args = macro.name.substr(open + 1);
+            boost::replace_last(args, ")", "");
+
+            std::vector<std::string> arguments;
+            split(args, arguments, ", ");
+
+            std::string templates, parameters;
+            for (std::size_t i = 0; i < arguments.size(); i++)
+            {
+                std::ostringstream type;
+                type << "T" << (i + 1);
+                templates += std::string(i > 0 ? ", " : "") + "typename " + type.str();
+                parameters += std::string(i > 0 ? ", " : "") + type.str() + " const& " + arguments[i];
+            }
+
+            if (! templates.empty())
+            {
+                stream << tab3 << "template <" << templates << ">" << std::endl;
+            }
+            stream
+                << tab3 << "inline BOOST_CONSTEXPR " << macro.type << " " << name
+                << "(" << parameters << ")" << std::endl
+                << tab3 << "{ return " << macro.value << "; }" << std::endl;
+        }
+
+        void write_undefs()
+        {
+            BOOST_FOREACH(macro_or_const const& macro, m_projpar.defined_macros)
+            {
+                if (! boost::contains(macro.name, "("))
+                {
+                    stream << tab3 << "#undef " << macro.name << std::endl;
+                }
+            }
+        }
+
         std::string preceded(std::string const& tab, std::string const& line) const
         {
             if (line.empty())
@@ -283,6 +537,8 @@ class proj4_writer_cpp_bg
         {
             std::string current_model;
             std::string current_subgroup;
+            bool analytic_factors = false;
+            projection const* forward = 0;
             for (size_t i = 0; i < m_projpar.projections.size(); i++)
             {
                 projection const& proj = m_projpar.projections[i];
@@ -298,12 +554,13 @@ class proj4_writer_cpp_bg
                         tbase += "i"; // base_fi
                     }
 
-                    tbase += "<" + name + "<Geographic, Cartesian, Parameters>,"
+                    tbase += "<" + name + "<Geographic, Cartesian, Parameters" + link_argument() + ", CalculationType" + mode_argument() + ">,"
                         + "\n" + tab5 + " Geographic, Cartesian, Parameters>";
 
                     stream
                         << tab3 << "// template class, using CRTP to implement forward/inverse" << std::endl
-                        << tab3 << "template <typename Geographic, typename Cartesian, typename Parameters>" << std::endl
+                        << tab3 << "template <typename Geographic, typename Cartesian, typename Parameters"
+                        << link_parameter() << ", typename CalculationType = double" << mode_parameter() << ">" << std::endl
                         << tab3 << "struct " << name << " : public " << tbase
                         << std::endl
                         << tab3 << "{" << std::endl << std::endl;
@@ -312,8 +569,8 @@ class proj4_writer_cpp_bg
                     stream
                         //<< tab4 << "typedef typename " << tbase << "::geographic_type geographic_type;" << std::endl
                         //<< tab4 << "typedef typename " << tbase << "::cartesian_type cartesian_type;" << std::endl
-                        << tab4 << " typedef double geographic_type;" << std::endl
-                        << tab4 << " typedef double cartesian_type;" << std::endl
+                        << tab4 << " typedef CalculationType geographic_type;" << std::endl
+                        << tab4 << " typedef CalculationType cartesian_type;" << std::endl
                         << std::endl;
 
 
@@ -335,6 +592,17 @@ class proj4_writer_cpp_bg
                         stream << ", " << s;
                     }
                     stream << " {}" << std::endl << std::endl;
+
+                    analytic_factors = false;
+                    forward = 0;
+
+                    if (! m_projpar.mode_values.empty())
+                    {
+                        stream
+                            << tab4 << "// Mode, if specified at compile time, resolving the switches in forward/inverse" << std::endl
+                            << tab4 << "inline int mode() const { return Mode >= 0 ? Mode : this->m_proj_parm.mode; }" << std::endl
+                            << std::endl;
+                    }
                 }
 
                 if (proj.model != current_model)
@@ -346,9 +614,14 @@ class proj4_writer_cpp_bg
                     write_endl_if_filled(proj.preceding_lines);
                 }
 
+                if (proj.direction == "forward")
+                {
+                    forward = &proj;
+                }
                 if (proj.direction == "special_factors")
                 {
-                    stream << tab4 << "#ifdef SPECIAL_FACTORS_NOT_CONVERTED" << std::endl;
+                    stream << tab4 << "// Scale factors calculated analytically, setting their flags in code" << std::endl;
+                    analytic_factors = true;
                 }
 
                 stream << tab4 << "inline void ";
@@ -362,8 +635,7 @@ class proj4_writer_cpp_bg
                 }
                 else if (proj.direction == "special_factors")
                 {
-                    stream
-                        << "fac(Geographic lp, Factors &fac";
+                    stream << "spc(geographic_type lp_lon, geographic_type lp_lat, factors<CalculationType>& fac";
                 }
                 else
                 {
@@ -379,19 +651,24 @@ class proj4_writer_cpp_bg
                 }
                 stream << tab4 << "}" << std::endl;
 
-                BOOST_FOREACH(std::string const& line, proj.trailing_lines)
+                if (proj.direction == "forward" || proj.direction == "inverse")
                 {
-                    stream << preceded(tab4, line) << std::endl;
+                    write_conversion_method(proj.direction);
                 }
 
-                if (proj.direction == "special_factors")
+                BOOST_FOREACH(std::string const& line, proj.trailing_lines)
                 {
-                    stream << tab4 << "#endif" << std::endl;
+                    stream << preceded(tab4, line) << std::endl;
                 }
 
                 // End of class
                 if (i == m_projpar.projections.size() - 1 || m_projpar.projections[i + 1].model != m_projpar.projections[i].model)
                 {
+                    write_factors_methods(analytic_factors);
+                    if (forward != 0)
+                    {
+                        write_grid_methods(*forward);
+                    }
                     stream << tab3 << "};" << std::endl;
                 }
                 stream << std::endl;
@@ -402,13 +679,44 @@ class proj4_writer_cpp_bg
         }
 
 
+        // Writes fwd or inv for other coordinate types than CalculationType,
+        // e.g. the double locals of pj_fwd/pj_inv for a float instantiation.
+        // For CalculationType itself the non template method is preferred
+        void write_conversion_method(std::string const& direction)
+        {
+            bool const fwd = direction == "forward";
+            std::string const in = fwd ? "geographic_type" : "cartesian_type";
+            std::string const out = fwd ? "cartesian_type" : "geographic_type";
+            std::string const in1 = fwd ? "lp_lon" : "xy_x";
+            std::string const in2 = fwd ? "lp_lat" : "xy_y";
+            std::string const out1 = fwd ? "xy_x" : "lp_lon";
+            std::string const out2 = fwd ? "xy_y" : "lp_lat";
+            std::string const method = fwd ? "fwd" : "inv";
+
+            stream
+                << std::endl
+                << tab4 << "// " << method << " for other coordinate types, converting them from and to CalculationType" << std::endl
+                << tab4 << "template <typename T>" << std::endl
+                << tab4 << "inline void " << method << "(T& " << in1 << ", T& " << in2
+                    << ", T& " << out1 << ", T& " << out2 << ") const" << std::endl
+                << tab4 << "{" << std::endl
+                << tab5 << in << " in1 = " << in << "(" << in1 << "), in2 = " << in << "(" << in2 << ");" << std::endl
+                << tab5 << out << " out1 = " << out << "(), out2 = " << out << "();" << std::endl
+                << tab5 << method << "(in1, in2, out1, out2);" << std::endl
+                << tab5 << in1 << " = T(in1);" << std::endl
+                << tab5 << in2 << " = T(in2);" << std::endl
+                << tab5 << out1 << " = T(out1);" << std::endl
+                << tab5 << out2 << " = T(out2);" << std::endl
+                << tab4 << "}" << std::endl;
+        }
+
         bool use_epsg() const
         {
             BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
             {
                 BOOST_FOREACH(epsg_entry const& entry, m_epsg_entries)
                 {
-                    if (entry.prj_name == der.name)
+                    if (entry.traits && entry.prj_name == der.name)
                     {
                         return true;
                     }
@@ -417,6 +725,48 @@ class proj4_writer_cpp_bg
             return false;
         }
 
+        // Returns the model the factory would create for the definition of
+        // an EPSG entry: spheroid for spheres (+R, +ellps=sphere, +a without
+        // flattening or equal to +b), guam if flagged, ellipsoid otherwise
+        model const* epsg_model(derived const& der, epsg_entry const& entry) const
+        {
+            if (der.models.size() == 1u)
+            {
+                return &der.models.front();
+            }
+
+            std::string const& definition = entry.parameters;
+            std::string value;
+            double a = 0, b = 0;
+            bool sphere = definition_parameter(definition, "R", value)
+                || (definition_parameter(definition, "ellps", value) && value == "sphere")
+                || (parameter_value(definition, "es", a) && a == 0);
+            if (! sphere && parameter_value(definition, "a", a))
+            {
+                sphere = parameter_value(definition, "b", b)
+                    ? a == b
+                    : ! definition_parameter(definition, "ellps", value)
+                        && ! definition_parameter(definition, "rf", value)
+                        && ! definition_parameter(definition, "f", value)
+                        && ! definition_parameter(definition, "es", value)
+                        && ! definition_parameter(definition, "e", value);
+            }
+
+            std::string const name = sphere ? "spheroid"
+                : definition_parameter(definition, "guam", value) ? "guam"
+                : "ellipsoid";
+            BOOST_FOREACH(model const& mod, der.models)
+            {
+                if (mod.name == name)
+                {
+                    return &mod;
+                }
+            }
+            std::cerr << "EPSG " << entry.epsg_code << ": no " << name
+                << " model for " << der.name << ", not specialized" << std::endl;
+            return 0;
+        }
+
         void write_setup()
         {
             BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
@@ -431,6 +781,8 @@ class proj4_writer_cpp_bg
                     stream << "typename ";
                     if (ts == "<Cartesian>") stream << "Cartesian";
                     else if (ts == "<Geographic, Cartesian>" || ts == "<Geographic, Cartesian, Parameters>") stream << "Geographic, typename Cartesian";
+                    else if (ts == "<Geographic, Cartesian, Parameters, CalculationType>") stream << "Geographic, typename Cartesian, typename CalculationType";
+                    else if (ts == "<Link>") stream << "Link";
                     stream << ", ";
                 }
 
@@ -468,6 +820,7 @@ class proj4_writer_cpp_bg
 
         void write_end_impl()
         {
+            write_undefs();
             stream << tab2 << "}} // namespace detail::" << projection_group << std::endl
                 << tab1 << "#endif // doxygen" << std::endl
                 << std::endl;
@@ -483,6 +836,7 @@ class proj4_writer_cpp_bg
         {
             BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
             {
+                write_traits(der);
                 BOOST_FOREACH(model const& mod, der.models)
                 {
                     std::string name = der.name + "_" + mod.name;
@@ -494,7 +848,7 @@ class proj4_writer_cpp_bg
                     if (m_projpar.valid)
                     {
                         std::string base = "detail::" + projection_group
-                            + "::base_" + mod.subgroup + "_" + mod.name + "<Geographic, Cartesian, Parameters>";
+                            + "::base_" + mod.subgroup + "_" + mod.name + "<Geographic, Cartesian, Parameters" + link_argument() + ", CalculationType" + mode_argument() + ">";
 
                         // Doxygen comments
                         stream
@@ -505,6 +859,24 @@ class proj4_writer_cpp_bg
                             << tab2 << "\\tparam Cartesian xy point type" << std::endl
                             << tab2 << "\\tparam Parameters parameter type" << std::endl
                         ;
+                        if (! m_projpar.link_type.empty())
+                        {
+                            stream
+                                << tab2 << "\\tparam Link type of the projection to be transformed, by default" << std::endl
+                                << tab2 << "       created at runtime. If it is known at compile time, specify" << std::endl
+                                << tab2 << "       it (e.g. merc_spheroid<Geographic, Cartesian, Parameters>)" << std::endl
+                                << tab2 << "       to avoid virtual calls and the factory" << std::endl
+                            ;
+                        }
+                        stream << tab2 << "\\tparam CalculationType type of the forward/inverse calculations (double or float)" << std::endl;
+                        if (! m_projpar.mode_values.empty())
+                        {
+                            stream
+                                << tab2 << "\\tparam Mode mode known at compile time (e.g. detail::" << projection_group
+                                << "::" << m_projpar.mode_values.front() << "), by default (-1)" << std::endl
+                                << tab2 << "       determined at runtime from the parameters" << std::endl
+                            ;
+                        }
 
                         if (! der.parsed_characteristics.empty())
                         {
@@ -537,12 +909,14 @@ class proj4_writer_cpp_bg
                             << tab2 << "\\image html ex_" << der.name << ".gif" << std::endl
                             << tab1 << "*/" << std::endl;
 
-                        // Class itself
+                        // Class itself (if split, the declaration has the defaults)
                         stream
-                            << tab1 << "template <typename Geographic, typename Cartesian, typename Parameters = parameters>" << std::endl
+                            << tab1 << class_template_parameters(! m_split) << std::endl
                             << tab1 << "struct " << name
                             << " : public " << base << std::endl
                             << tab1 << "{"  << std::endl
+                            << tab2 << "typedef " << der.name << "_traits traits;" << std::endl
+                            << std::endl
                             << tab2 << "inline " << name << "(const Parameters& par) : " << base << "(par)" << std::endl
                             << tab2 << "{" << std::endl
                             << tab3 << "detail::" << projection_group << "::setup_" << der.name << "(this->m_par";
@@ -550,7 +924,12 @@ class proj4_writer_cpp_bg
                         {
                             stream << ", this->m_proj_parm";
                         }
-                        stream << ");" << std::endl
+                        stream << ");" << std::endl;
+                        if (! m_projpar.mode_values.empty())
+                        {
+                            stream << tab3 << "BOOST_ASSERT(Mode < 0 || Mode == this->m_proj_parm.mode);" << std::endl;
+                        }
+                        stream
                             << tab2 << "}" << std::endl
                             << tab1 << "};" << std::endl
                             << std::endl;
@@ -559,6 +938,314 @@ class proj4_writer_cpp_bg
             }
         }
 
+        static bool has_characteristic(derived const& der, std::string const& characteristic)
+        {
+            return std::find(der.parsed_characteristics.begin(), der.parsed_characteristics.end(),
+                        characteristic) != der.parsed_characteristics.end();
+        }
+
+        static std::string parameter_type(parameter const& p)
+        {
+            std::string const& type = p.type;
+            return ! p.used ? "unknown_parameter"
+                : boost::contains(type, "degrees") ? "degrees_parameter"
+                : boost::contains(type, "real") ? "real_parameter"
+                : boost::contains(type, "integer") ? "integer_parameter"
+                : boost::contains(type, "boolean") ? "boolean_parameter"
+                : boost::contains(type, "string") ? "string_parameter"
+                : "flag_parameter";
+        }
+
+        // Writes what the documenter found about a projection (its
+        // characteristics and parameters) and what its models support,
+        // such that it can be used at compile time
+        void write_traits(derived const& der)
+        {
+            if (! m_projpar.valid)
+            {
+                return;
+            }
+
+            bool has_inverse = ! der.models.empty();
+            bool separable = ! der.models.empty();
+            BOOST_FOREACH(model const& mod, der.models)
+            {
+                projection const* forward = forward_of(mod);
+                has_inverse = has_inverse && mod.has_inverse;
+                separable = separable && forward != 0 && forward->grid == "separable";
+            }
+
+            std::string const constant = "BOOST_STATIC_CONSTEXPR ";
+            stream
+                << tab1 << "// Characteristics of " << der.name << " (" << der.description << "), known at compile time" << std::endl
+                << tab1 << "struct " << der.name << "_traits" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "static inline char const* name() { return \"" << der.name << "\"; }" << std::endl
+                << std::endl
+                << tab2 << constant << "bool azimuthal = " << bool_string(has_characteristic(der, "Azimuthal")
+                        || has_characteristic(der, "Azimuthal (mod)")) << ";" << std::endl
+                << tab2 << constant << "bool conic = " << bool_string(has_characteristic(der, "Conic")) << ";" << std::endl
+                << tab2 << constant << "bool polyconic = " << bool_string(has_characteristic(der, "Polyconic")
+                        || has_characteristic(der, "Mod. Polyconic")) << ";" << std::endl
+                << tab2 << constant << "bool cylindrical = " << bool_string(has_characteristic(der, "Cylindrical")) << ";" << std::endl
+                << tab2 << constant << "bool pseudocylindrical = " << bool_string(has_characteristic(der, "Pseudocylindrical")) << ";" << std::endl
+                << tab2 << constant << "bool miscellaneous = " << bool_string(has_characteristic(der, "Miscellaneous")) << ";" << std::endl
+                << tab2 << constant << "bool ellipsoid = " << bool_string(has_characteristic(der, "Ellipsoid")) << ";" << std::endl
+                << tab2 << constant << "bool spheroid = " << bool_string(has_characteristic(der, "Spheroid")) << ";" << std::endl
+                << tab2 << "// true if all models have an inverse" << std::endl
+                << tab2 << constant << "bool has_inverse = " << bool_string(has_inverse) << ";" << std::endl
+                << tab2 << "// true if all forwards are separable (see grid_traits)" << std::endl
+                << tab2 << constant << "bool separable = " << bool_string(separable) << ";" << std::endl;
+
+            std::vector<parameter const*> parameters;
+            std::set<std::string> names;
+            BOOST_FOREACH(parameter const& p, der.parsed_parameters)
+            {
+                if (is_name(p.name) && names.insert(p.name).second)
+                {
+                    parameters.push_back(&p);
+                }
+            }
+            if (! parameters.empty())
+            {
+                stream
+                    << std::endl
+                    << tab2 << "struct parameter_types" << std::endl
+                    << tab2 << "{" << std::endl;
+                BOOST_FOREACH(parameter const* p, parameters)
+                {
+                    stream << tab3 << constant << "parameter_type " << p->name
+                        << " = " << parameter_type(*p) << ";" << std::endl;
+                }
+                stream << tab2 << "};" << std::endl;
+            }
+            stream
+                << tab1 << "};" << std::endl
+                << std::endl;
+        }
+
+        static std::string bool_string(bool value)
+        {
+            return value ? "true" : "false";
+        }
+
+        // Returns the forward of a model, or 0
+        projection const* forward_of(model const& mod) const
+        {
+            BOOST_FOREACH(projection const& proj, m_projpar.projections)
+            {
+                if (proj.direction == "forward" && proj.model == mod.name
+                    && proj.subgroup == mod.subgroup)
+                {
+                    return &proj;
+                }
+            }
+            return 0;
+        }
+
+        // Writes the specializations of the trait telling how fwd_grid
+        // transforms grids (impl/projection_traits.hpp) for the projection
+        // classes transforming them faster than per point
+        void write_grid_traits()
+        {
+            if (! m_projpar.valid)
+            {
+                return;
+            }
+
+            std::vector<std::string> const names = class_names();
+            std::size_t index = 0;
+            BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
+            {
+                BOOST_FOREACH(model const& mod, der.models)
+                {
+                    std::string const& name = names[index++];
+                    projection const* forward = forward_of(mod);
+                    if (forward == 0 || (forward->grid != "separable" && forward->row_lines.empty()))
+                    {
+                        continue;
+                    }
+                    stream
+                        << tab1 << class_template_parameters(false) << std::endl
+                        << tab1 << "struct grid_traits<" << name << "<Geographic, Cartesian, Parameters"
+                        << link_argument() << ", CalculationType" << mode_argument() << "> >" << std::endl
+                        << tab1 << "{" << std::endl
+                        << tab2 << "BOOST_STATIC_CONSTEXPR grid_kind kind = "
+                        << (forward->grid == "separable" ? "grid_separable" : "grid_rows") << ";" << std::endl
+                        << tab1 << "};" << std::endl
+                        << std::endl;
+                }
+            }
+        }
+
+        // Returns the template parameters of the projection classes,
+        // with or without their default arguments
+        std::string class_template_parameters(bool defaults) const
+        {
+            if (defaults)
+            {
+                return "template <typename Geographic, typename Cartesian, typename Parameters = parameters"
+                    + link_parameter() + ", typename CalculationType = double" + mode_parameter() + ">";
+            }
+            return "template <typename Geographic, typename Cartesian, typename Parameters"
+                + std::string(m_projpar.link_type.empty() ? "" : ", typename Link")
+                + ", typename CalculationType" + mode_parameter(false) + ">";
+        }
+
+        // Returns the names of the projection classes
+        std::vector<std::string> class_names() const
+        {
+            std::vector<std::string> result;
+            if (m_projpar.valid)
+            {
+                BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
+                {
+                    BOOST_FOREACH(model const& mod, der.models)
+                    {
+                        result.push_back(mod.subgroup != projection_group
+                            ? mod.subgroup + "_" + mod.name
+                            : der.name + "_" + mod.name);
+                    }
+                }
+            }
+            return result;
+        }
+
+        // Returns the point types for which the classes are explicitly
+        // instantiated: geographic in degree or radian, and cartesian xy
+        std::vector<std::string> instantiation_arguments() const
+        {
+            std::string const xy = "model::d2::point_xy<double>";
+            std::vector<std::string> result;
+            result.push_back("model::point<double, 2, cs::geographic<degree> >, " + xy);
+            result.push_back("model::point<double, 2, cs::geographic<radian> >, " + xy);
+            return result;
+        }
+
+        // Writes the light header, declaring the projection classes only,
+        // such that they can be named without including the implementation
+        void write_declarations()
+        {
+            std::string const fwd = "BOOST_GEOMETRY_PROJECTIONS_"
+                + boost::to_upper_copy(projection_group) + "_FWD_HPP";
+            stream << "#ifndef " << fwd << std::endl
+                << "#define " << fwd << std::endl
+                << std::endl;
+
+            write_copyright();
+
+            if (! m_projpar.link_type.empty())
+            {
+                stream << "#include <boost/shared_ptr.hpp>" << std::endl << std::endl;
+            }
+
+            stream
+                << "namespace boost { namespace geometry { namespace projections" << std::endl
+                << "{" << std::endl
+                << std::endl
+                << tab1 << "struct parameters;" << std::endl;
+            if (! m_projpar.link_type.empty())
+            {
+                stream << tab1 << "template <typename Geographic, typename Cartesian> class projection;" << std::endl;
+            }
+            stream << std::endl;
+
+            BOOST_FOREACH(std::string const& name, class_names())
+            {
+                stream
+                    << tab1 << class_template_parameters(true) << std::endl
+                    << tab1 << "struct " << name << ";" << std::endl
+                    << std::endl;
+            }
+
+            stream
+                << "}}} // namespace boost::geometry::projections" << std::endl << std::endl
+                << "#endif // " << fwd << std::endl << std::endl;
+        }
+
+        // Writes extern declarations of the explicit instantiations, such that
+        // translation units linking the instantiations do not instantiate again
+        void write_extern_instantiations()
+        {
+            std::vector<std::string> const names = class_names();
+            if (names.empty())
+            {
+                return;
+            }
+
+            stream << tab1 << extern_instantiations_condition() << std::endl;
+            BOOST_FOREACH(std::string const& name, names)
+            {
+                BOOST_FOREACH(std::string const& args, instantiation_arguments())
+                {
+                    stream << tab1 << "extern template struct " << name << "<" << args << instantiation_link() << " >;" << std::endl;
+                }
+            }
+            stream
+                << tab1 << "#endif" << std::endl
+                << std::endl;
+        }
+
+        static std::string extern_instantiations_condition()
+        {
+            return "#if defined(BOOST_GEOMETRY_PROJECTIONS_EXTERN_INSTANTIATIONS) && ! defined(BOOST_NO_CXX11_EXTERN_TEMPLATE)";
+        }
+
+        // Projections with a link are instantiated with its default
+        std::string instantiation_link() const
+        {
+            return m_projpar.link_type.empty() ? "" : ", parameters";
+        }
+
+        static void write_instantiation_includes(std::ostream& stream)
+        {
+            stream
+                << "#include <boost/geometry/core/cs.hpp>" << std::endl
+                << "#include <boost/geometry/geometries/point.hpp>" << std::endl
+                << "#include <boost/geometry/geometries/point_xy.hpp>" << std::endl;
+        }
+
+        // Writes the source file with explicit instantiations, for the
+        // common double based point types
+        void write_instantiations()
+        {
+            write_copyright();
+            write_instantiation_includes(stream);
+            stream << std::endl;
+            if (! m_projpar.link_type.empty())
+            {
+                // The default link is created by the factory
+                stream << include_projections << "/factory.hpp>" << std::endl;
+            }
+            stream
+                << include_projections << "/proj/" << projection_group << ".hpp>" << std::endl
+                << std::endl
+                << "namespace boost { namespace geometry { namespace projections" << std::endl
+                << "{" << std::endl
+                << std::endl;
+
+            BOOST_FOREACH(std::string const& name, class_names())
+            {
+                BOOST_FOREACH(std::string const& args, instantiation_arguments())
+                {
+                    stream << tab1 << "template struct " << name << "<" << args << instantiation_link() << " >;" << std::endl;
+                }
+            }
+            if (m_projpar.valid)
+            {
+                stream << std::endl;
+                BOOST_FOREACH(std::string const& args, instantiation_arguments())
+                {
+                    stream << tab1 << "template void detail::" << projection_group << "_init(detail::base_factory<"
+                        << args << ", parameters>&);" << std::endl;
+                }
+            }
+
+            stream
+                << std::endl
+                << "}}} // namespace boost::geometry::projections" << std::endl << std::endl;
+        }
+
         void write_wrappers()
         {
             stream
@@ -568,16 +1255,31 @@ class proj4_writer_cpp_bg
 
             std::string templates = "template <typename Geographic, typename Cartesian, typename Parameters>";
 
-
-            // TEMP: get model from below
-            // TODO: get model from epsg-parameter
-            std::string epsg_model = "";
-
             // Create factory entries
             // This complicated piece has
             // - to decide to take either "ellipsoid" or "spheroid" based on the input parameter
             // - to decide if it is the forward or forward/reverse model
 
+            if (! m_projpar.mode_values.empty())
+            {
+                // Dynamic projection of a specialization for a mode, constructed
+                // from parameters on which the factory entry already ran the setup
+                stream
+                    << tab2 << "// Dynamic projection of the specialization for a mode, constructed from" << std::endl
+                    << tab2 << "// parameters which are already set up (by the factory entry)" << std::endl
+                    << tab2 << "template <typename Base>" << std::endl
+                    << tab2 << "class " << projection_group << "_mode_v : public Base" << std::endl
+                    << tab2 << "{" << std::endl
+                    << tab3 << "public :" << std::endl
+                    << tab4 << "template <typename Parameters, typename ProjParm>" << std::endl
+                    << tab4 << "inline " << projection_group << "_mode_v(const Parameters& par, const ProjParm& proj_parm) : Base(par)" << std::endl
+                    << tab4 << "{" << std::endl
+                    << tab5 << "this->m_proj.m_proj_parm = proj_parm;" << std::endl
+                    << tab4 << "}" << std::endl
+                    << tab2 << "};" << std::endl
+                    << std::endl;
+            }
+
             stream << tab2 << "// Factory entry(s)" << std::endl;
             BOOST_FOREACH(derived const& der, m_projpar.derived_projections)
             {
@@ -627,13 +1329,44 @@ class proj4_writer_cpp_bg
                         base += "i";
                     }
                     std::string name = der.name + "_" + mod.name;
-                    stream << tab << "return new " << base
-                        << "<" << name << "<Geographic, Cartesian, Parameters>, Geographic, Cartesian, Parameters>(par);" << std::endl;
-
-                    if (epsg_model.empty())
+                    if (! m_projpar.mode_values.empty())
                     {
-                        epsg_model = mod.name;
+                        // Run the setup once, create the specialization for its mode
+                        // from the prepared parameters (the impl class has no setup)
+                        std::string const prefix = mod.condition.empty() ? tab5 : tab;
+                        std::string const impl = "detail::" + projection_group
+                            + "::base_" + mod.subgroup + "_" + mod.name + "<Geographic, Cartesian, Parameters, double";
+                        std::string const wrapper = projection_group + "_mode_v<" + base + "<";
+                        if (! mod.condition.empty())
+                        {
+                            stream << tab5 << "{" << std::endl;
+                        }
+                        stream
+                            << prefix << "Parameters p = par;" << std::endl
+                            << prefix << "detail::" << projection_group << "::par_" << projection_group
+                            << boost::replace_all_copy(m_projpar.template_struct, "CalculationType", "double")
+                            << " proj_parm;" << std::endl
+                            << prefix << "detail::" << projection_group << "::setup_" << der.name << "(p, proj_parm);" << std::endl
+                            << prefix << "switch (proj_parm.mode)" << std::endl
+                            << prefix << "{" << std::endl;
+                        BOOST_FOREACH(std::string const& value, m_projpar.mode_values)
+                        {
+                            stream << prefix << tab1 << "case detail::" << projection_group << "::" << value
+                                << " : return new " << wrapper << impl << ", detail::" << projection_group << "::" << value
+                                << ">, Geographic, Cartesian, Parameters> >(p, proj_parm);" << std::endl;
+                        }
+                        stream
+                            << prefix << "}" << std::endl
+                            << prefix << "return new " << wrapper << impl
+                            << ">, Geographic, Cartesian, Parameters> >(p, proj_parm);" << std::endl;
+                        if (! mod.condition.empty())
+                        {
+                            stream << tab5 << "}" << std::endl;
+                        }
+                        continue;
                     }
+                    stream << tab << "return new " << base
+                        << "<" << name << "<Geographic, Cartesian, Parameters>, Geographic, Cartesian, Parameters>(par);" << std::endl;
                 }
                 stream
                     << tab4 << "}" << std::endl
@@ -665,17 +1398,32 @@ class proj4_writer_cpp_bg
                 {
                     BOOST_FOREACH(epsg_entry const& entry, m_epsg_entries)
                     {
-                        if (entry.prj_name == der.name)
+                        model const* mod = 0;
+                        if (entry.traits && entry.prj_name == der.name)
                         {
+                            mod = epsg_model(der, entry);
+                        }
+                        if (mod != 0)
+                        {
+                            std::string const name = mod->subgroup != projection_group
+                                ? mod->subgroup + "_" + mod->name
+                                : der.name + "_" + mod->name;
                             stream << tab1 << "template<typename LatLongRadian, typename Cartesian, typename Parameters>" << std::endl
                                 << tab1 << "struct epsg_traits<" << entry.epsg_code << ", LatLongRadian, Cartesian, Parameters>" << std::endl
                                 << tab1 << "{" << std::endl
-                                // TODO, model, see above
-                                << tab2 << "typedef " << der.name << "_" << epsg_model << "<LatLongRadian, Cartesian, Parameters> type;" << std::endl
+                                << tab2 << "typedef " << name << "<LatLongRadian, Cartesian, Parameters> type;" << std::endl
                                 << tab2 << "static inline std::string par()" << std::endl
                                 << tab2 << "{" << std::endl
                                 << tab3 << "return \"" << entry.parameters << "\";" << std::endl
                                 << tab2 << "}" << std::endl
+                                << tab2 << "// Initialized and set up once, copies do not repeat that. The local" << std::endl
+                                << tab2 << "// static is initialized thread-safely in C++11; in C++03 the first call" << std::endl
+                                << tab2 << "// should be made before other threads can make it" << std::endl
+                                << tab2 << "static inline type const& instance()" << std::endl
+                                << tab2 << "{" << std::endl
+                                << tab3 << "static type const prj(projections::init(par()));" << std::endl
+                                << tab3 << "return prj;" << std::endl
+                                << tab2 << "}" << std::endl
                                 << tab1 << "};" << std::endl
                                 << std::endl
                                 << std::endl;
@@ -697,6 +1445,7 @@ class proj4_writer_cpp_bg
 
         std::string projection_group;
         std::string hpp;
+        bool m_split; // declarations are in a separate header
 };
 
 }}} // namespace boost::geometry::proj4converter
@@ -0,0 +1,320 @@
+#ifndef TISSOT_COMPARE_WRITER_HPP
+#define TISSOT_COMPARE_WRITER_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/foreach.hpp>
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+#include "tissot_benchmark_writer.hpp"
+
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Writes a program comparing each projection and model with the original
+// proj4 implementation (pj_fwd/pj_inv), on the same input as the benchmark.
+// Reports CSV with both timings, their ratio and the max difference
+class proj4_compare_writer
+{
+    public :
+        proj4_compare_writer(projection_properties& projpar
+                , std::string const& group
+                , std::ostream& str)
+            : m_prop(projpar)
+            , stream(str)
+            , projection_group(group)
+        {
+        }
+
+        void write()
+        {
+            write_header();
+            write_functions();
+
+            stream
+                << "int main(int argc, char** argv)" << std::endl
+                << "{" << std::endl
+                << tab1 << "// Extra parameters (e.g. +lat_0=45) can be passed on the command line" << std::endl
+                << tab1 << "std::string extra;" << std::endl
+                << tab1 << "bool header = true;" << std::endl
+                << tab1 << "for (int i = 1; i < argc; i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "if (std::string(argv[i]) == \"--no-header\")" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "header = false;" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "else" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "extra += std::string(\" \") + argv[i];" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "if (header)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cout << \"group,projection,model,direction,points,"
+                << "ns_generated,ns_proj4,speed_ratio,max_difference_m\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl;
+
+            if (! m_prop.valid)
+            {
+                stream << tab1 << "// " << projection_group << " is not converted" << std::endl;
+            }
+            else
+            {
+                BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+                {
+                    BOOST_FOREACH(model const& mod, der.models)
+                    {
+                        write_compare(der, mod);
+                    }
+                }
+            }
+
+            stream
+                << tab1 << "return 0;" << std::endl
+                << "}" << std::endl;
+        }
+
+    private :
+
+        void write_header()
+        {
+            stream
+                << "// Comparison of " << projection_group
+                << " with proj4: timing and differences of forward and inverse" << std::endl
+                << "// Generated by tissot, compile it with optimization against the generated projection" << std::endl
+                << "// and link it with proj4" << std::endl
+                << std::endl
+                << "#include <cmath>" << std::endl
+                << "#include <ctime>" << std::endl
+                << "#include <iostream>" << std::endl
+                << "#include <string>" << std::endl
+                << "#include <vector>" << std::endl
+                << std::endl
+                << "#include <proj_api.h>" << std::endl
+                << std::endl
+                << "#include <boost/geometry.hpp>" << std::endl
+                << include_projections << "/parameters.hpp>" << std::endl;
+            if (! m_prop.link_type.empty())
+            {
+                // The default link is created by the factory
+                stream << include_projections << "/factory.hpp>" << std::endl;
+            }
+            stream
+                << include_projections << "/proj/" << projection_group << ".hpp>" << std::endl
+                << std::endl
+                << "namespace bg = boost::geometry;" << std::endl
+                << "namespace bgp = boost::geometry::projections;" << std::endl
+                << std::endl
+                << "typedef bg::model::point<double, 2, bg::cs::cartesian> point_type;" << std::endl
+                << std::endl
+                << "// Area, in degrees, of the grid" << std::endl
+                << "struct grid_type" << std::endl
+                << "{" << std::endl
+                << tab1 << "double lon_min, lon_max, lat_min, lat_max, step;" << std::endl
+                << "};" << std::endl
+                << std::endl;
+        }
+
+        void write_call(std::string const& name, std::string const& call)
+        {
+            stream
+                << "template <typename Prj>" << std::endl
+                << "struct generated_" << name << std::endl
+                << "{" << std::endl
+                << tab1 << "Prj const& prj;" << std::endl
+                << tab1 << "explicit generated_" << name << "(Prj const& p) : prj(p) {}" << std::endl
+                << tab1 << "void operator()(point_type const& p, point_type& q) const" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "prj." << name << "(p, q);" << std::endl
+                << tab1 << "}" << std::endl
+                << "};" << std::endl
+                << std::endl
+                << "struct proj4_" << name << std::endl
+                << "{" << std::endl
+                << tab1 << "projPJ pj;" << std::endl
+                << tab1 << "explicit proj4_" << name << "(projPJ p) : pj(p) {}" << std::endl
+                << tab1 << "void operator()(point_type const& p, point_type& q) const" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "projUV uv;" << std::endl
+                << tab2 << "uv.u = bg::get<0>(p);" << std::endl
+                << tab2 << "uv.v = bg::get<1>(p);" << std::endl
+                << tab2 << "uv = " << call << "(uv, pj);" << std::endl
+                << tab2 << "q = point_type(uv.u, uv.v);" << std::endl
+                << tab1 << "}" << std::endl
+                << "};" << std::endl
+                << std::endl;
+        }
+
+        void write_functions()
+        {
+            write_call("forward", "pj_fwd");
+            write_call("inverse", "pj_inv");
+
+            stream
+                << "// Returns false for NaN, and for HUGE_VAL returned by proj4 on errors" << std::endl
+                << "inline bool is_valid(point_type const& p)" << std::endl
+                << "{" << std::endl
+                << tab1 << "double const x = bg::get<0>(p);" << std::endl
+                << tab1 << "double const y = bg::get<1>(p);" << std::endl
+                << tab1 << "return x == x && y == y && std::fabs(x) < 1.0e30 && std::fabs(y) < 1.0e30;" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "// Returns the difference in metres, for geographic points on the sphere" << std::endl
+                << "// with the specified radius, otherwise the cartesian distance" << std::endl
+                << "inline double difference(point_type const& p, point_type const& q, double radius)" << std::endl
+                << "{" << std::endl
+                << tab1 << "double dx = bg::get<0>(p) - bg::get<0>(q);" << std::endl
+                << tab1 << "double const dy = bg::get<1>(p) - bg::get<1>(q);" << std::endl
+                << tab1 << "if (radius > 0.0)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "double const pi = bg::math::pi<double>();" << std::endl
+                << tab2 << "while (dx > pi) dx -= 2.0 * pi;" << std::endl
+                << tab2 << "while (dx < -pi) dx += 2.0 * pi;" << std::endl
+                << tab2 << "dx *= std::cos(bg::get<1>(p));" << std::endl
+                << tab2 << "return radius * std::sqrt(dx * dx + dy * dy);" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "return std::sqrt(dx * dx + dy * dy);" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "// Returns the nanoseconds per point, repeating the calls for at least 0.2 seconds" << std::endl
+                << "template <typename Call>" << std::endl
+                << "double time_points(std::vector<point_type> const& points, Call const& call)" << std::endl
+                << "{" << std::endl
+                << tab1 << "if (points.empty())" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "return 0.0;" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "volatile double sink = 0.0;" << std::endl
+                << tab1 << "long repetitions = 0;" << std::endl
+                << tab1 << "std::clock_t const start = std::clock();" << std::endl
+                << tab1 << "std::clock_t elapsed = 0;" << std::endl
+                << tab1 << "do" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (std::size_t i = 0; i < points.size(); i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "point_type result;" << std::endl
+                << tab3 << "call(points[i], result);" << std::endl
+                << tab3 << "sink = sink + bg::get<0>(result);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "repetitions++;" << std::endl
+                << tab2 << "elapsed = std::clock() - start;" << std::endl
+                << tab1 << "} while (elapsed < CLOCKS_PER_SEC / 5);" << std::endl
+                << tab1 << "return 1.0e9 * elapsed / CLOCKS_PER_SEC / (double(repetitions) * points.size());" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "std::vector<point_type> create_grid(grid_type const& grid)" << std::endl
+                << "{" << std::endl
+                << tab1 << "double const d2r = bg::math::d2r<double>();" << std::endl
+                << tab1 << "int const nlon = int((grid.lon_max - grid.lon_min) / grid.step + 0.5);" << std::endl
+                << tab1 << "int const nlat = int((grid.lat_max - grid.lat_min) / grid.step + 0.5);" << std::endl
+                << tab1 << "std::vector<point_type> result;" << std::endl
+                << tab1 << "for (int j = 0; j <= nlat; j++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (int i = 0; i <= nlon; i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "result.push_back(point_type((grid.lon_min + i * grid.step) * d2r," << std::endl
+                << tab3 << "    (grid.lat_min + j * grid.step) * d2r));" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "return result;" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "// Compares and times the points for which both succeed, and returns" << std::endl
+                << "// the results of the generated projection (as input for the inverse)" << std::endl
+                << "template <typename Generated, typename Proj4>" << std::endl
+                << "void compare(std::string const& prefix, Generated const& generated, Proj4 const& proj4," << std::endl
+                << tab1 << "std::vector<point_type> const& input, double radius, std::vector<point_type>& output)" << std::endl
+                << "{" << std::endl
+                << tab1 << "std::vector<point_type> points;" << std::endl
+                << tab1 << "double max_difference = 0.0;" << std::endl
+                << tab1 << "for (std::size_t i = 0; i < input.size(); i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "point_type result, expected;" << std::endl
+                << tab2 << "try" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "generated(input[i], result);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "continue;" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "proj4(input[i], expected);" << std::endl
+                << tab2 << "if (is_valid(result) && is_valid(expected))" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "points.push_back(input[i]);" << std::endl
+                << tab3 << "output.push_back(result);" << std::endl
+                << tab3 << "max_difference = (std::max)(max_difference, difference(result, expected, radius));" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << tab1 << "double const ns_generated = time_points(points, generated);" << std::endl
+                << tab1 << "double const ns_proj4 = time_points(points, proj4);" << std::endl
+                << tab1 << "std::cout << prefix << \",\" << points.size()" << std::endl
+                << tab1 << "    << \",\" << ns_generated << \",\" << ns_proj4" << std::endl
+                << tab1 << "    << \",\" << (ns_generated > 0.0 ? ns_proj4 / ns_generated : 0.0)" << std::endl
+                << tab1 << "    << \",\" << max_difference << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl;
+        }
+
+        void write_compare(derived const& der, model const& mod)
+        {
+            std::string const name = benchmark_class_name(der, mod, projection_group);
+            std::string const prefix = projection_group + "," + der.name + "," + mod.name;
+
+            // Projections requiring other parameters throw if they are not passed
+            stream
+                << tab1 << "try" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "typedef bgp::" << name << "<point_type, point_type> prj_type;" << std::endl
+                << tab2 << "grid_type const grid = " << benchmark_grid(der) << ";" << std::endl
+                << tab2 << "std::string const definition = \"" << benchmark_definition(der, mod) << "\" + extra;" << std::endl
+                << tab2 << "bgp::parameters const par = bgp::init(definition);" << std::endl
+                << tab2 << "prj_type const prj(par);" << std::endl
+                << tab2 << "projPJ pj = pj_init_plus(definition.c_str());" << std::endl
+                << tab2 << "if (pj == 0)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "std::cerr << \"" << name << ": not initialized by proj4\" << std::endl;" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "else" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "std::vector<point_type> xys;" << std::endl
+                << tab3 << "compare(\"" << prefix << ",forward\", generated_forward<prj_type>(prj), proj4_forward(pj)," << std::endl
+                << tab3 << "    create_grid(grid), 0.0, xys);" << std::endl;
+            if (mod.has_inverse)
+            {
+                stream
+                    << tab3 << "std::vector<point_type> lls;" << std::endl
+                    << tab3 << "compare(\"" << prefix << ",inverse\", generated_inverse<prj_type>(prj), proj4_inverse(pj)," << std::endl
+                    << tab3 << "    xys, par.a, lls);" << std::endl;
+            }
+            stream
+                << tab3 << "pj_free(pj);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cerr << \"" << name << ": not initialized, pass its parameters\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl;
+        }
+
+        projection_properties& m_prop;
+        std::ostream& stream;
+        std::string projection_group;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_COMPARE_WRITER_HPP
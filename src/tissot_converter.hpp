@@ -12,10 +12,16 @@
 
 #include "tissot_structs.hpp"
 #include "tissot_util.hpp"
+#include "tissot_cse.hpp"
+#include "tissot_precompute.hpp"
+#include "tissot_localize.hpp"
+#include "tissot_grid.hpp"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 
+#include <cstring>
 #include <sstream>
 
 namespace boost { namespace geometry { namespace proj4converter
@@ -44,6 +50,7 @@ public :
         replace_apple_macros();
         replace_ctx();
         replace_struct_parameters();
+        remove_duplicate_macros();
         determine_const_types();
 
         for_each_line(&proj4_converter_cpp_bg::replace_exceptions);
@@ -54,6 +61,18 @@ public :
     void post_convert()
     {
         replace_all_functions();
+        share_ellipsoid_tables();
+        convert_scale_factors();
+        localize_proj_parameters();
+        precompute_invariants();
+        hoist_common_subexpressions();
+        fuse_sincos();
+        use_calculation_type();
+        specialize_modes();
+        report_constexpr_setup();
+        index_parameter_lookups();
+        order_proj_parameters();
+        analyze_forward_grids();
     }
 
     void trim()
@@ -68,6 +87,16 @@ public :
     {
         check_unused_parameters();
         for_each_line(&proj4_converter_cpp_bg::scan_includes);
+        if (m_prop.valid || ! m_prop.defined_consts.empty() || ! m_prop.defined_macros.empty())
+        {
+            // For BOOST_CONSTEXPR, and BOOST_STATIC_CONSTEXPR of the traits
+            m_prop.extra_includes.insert("boost/config.hpp");
+        }
+        if (m_prop.valid)
+        {
+            m_prop.extra_impl_includes.insert("approximate_transformer.hpp");
+            m_prop.extra_impl_includes.insert("projection_traits.hpp");
+        }
     }
 
 private :
@@ -114,7 +143,7 @@ private :
             std::string trimmed = boost::trim_copy(line);
             if (! boost::starts_with(trimmed, "//"))
             {
-                if (boost::contains(line, "par."))
+                if (contains_name(line, "par"))
                 {
                     par_used = true;
                 }
@@ -149,7 +178,8 @@ private :
             {
                 m_prop.extra_impl_includes.insert("pj_mlfn.hpp");
             }
-            if (boost::contains(line, "pj_auth"))
+            if (boost::contains(line, "pj_auth")
+                || boost::contains(line, "shared_authset"))
             {
                 m_prop.extra_impl_includes.insert("pj_auth.hpp");
             }
@@ -177,6 +207,12 @@ private :
             {
                 m_prop.extra_impl_includes.insert("pj_zpoly1.hpp");
             }
+            if (boost::contains(line, "shared_enfn")
+                || boost::contains(line, "shared_authset")
+                || boost::contains(line, "shared_mdist_ini"))
+            {
+                m_prop.extra_impl_includes.insert("shared_tables.hpp");
+            }
 
             // Boost
             if (boost::contains(line, "hypot"))
@@ -191,6 +227,14 @@ private :
             {
                 m_prop.extra_includes.insert("boost/shared_ptr.hpp");
             }
+            if (boost::contains(line, "boost::optional"))
+            {
+                m_prop.extra_includes.insert("boost/optional.hpp");
+            }
+            if (boost::contains(line, "boost::in_place"))
+            {
+                m_prop.extra_includes.insert("boost/utility/in_place_factory.hpp");
+            }
 
             // Geometry
             if (boost::contains(line, "::d2r<")
@@ -305,7 +349,8 @@ private :
         {
             if (boost::contains(line, "->"))
             {
-                boost::replace_all(line, "fac->", prefix + "fac.");
+                // Scale factors are passed to the converted SPECIAL block
+                boost::replace_all(line, "fac->", "fac.");
                 boost::replace_all(line, "P->", prefix + "par.");
                 boost::replace_all(line, "P -> ", prefix + "par.");
                 // Refer to project-specific parameters
@@ -645,24 +690,1998 @@ private :
         for_each_line(&proj4_converter_cpp_bg::pass_parameter_instead_of_return);
     }
 
-    void determine_const_types()
+    bool replace_table_declaration(std::string const& type,
+            std::string const& declarator, std::string const& replacement)
     {
-        BOOST_FOREACH(macro_or_const& con, m_prop.defined_consts)
+        // Replaces for example "double en[EN_SIZE];" by "double const* en;"
+        // (also if it is declared together with other variables)
+        for (std::vector<std::string>::iterator it = m_prop.proj_parameters.begin();
+            it != m_prop.proj_parameters.end(); ++it)
         {
-            // By default:
-            con.type = "double";
+            std::string nospaces = *it;
+            strip_comments(nospaces);
+            boost::replace_all(nospaces, " ", "");
+            if (nospaces == type + declarator + ";")
+            {
+                *it = replacement;
+                return true;
+            }
 
-            // Check if integer:
+            std::string::size_type pos = it->find(declarator);
+            if (boost::contains(declarator, "[") && pos != std::string::npos)
             {
-                int value = atoi(con.value.c_str());
-                std::ostringstream out;
-                out << value;
-                if (out.str() == con.value)
+                // Erase declarator, including preceding or following comma
+                std::string& line = *it;
+                std::string::size_type end = pos + declarator.length();
+                std::string::size_type begin = line.find_last_not_of(' ', pos - 1);
+                if (begin != std::string::npos && line[begin] == ',')
                 {
-                    con.type = "int";
+                    line.erase(begin, end - begin);
+                }
+                else
+                {
+                    end = line.find_first_not_of(' ', end);
+                    if (end != std::string::npos && line[end] == ',')
+                    {
+                        end = line.find_first_not_of(' ', end + 1);
+                    }
+                    line.erase(pos, end - pos);
+                }
+                m_prop.proj_parameters.insert(it + 1, replacement);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void replace_table_initialization(std::vector<std::string>& lines)
+    {
+        BOOST_FOREACH(std::string& line, lines)
+        {
+            boost::replace_all(line, "pj_enfn(par.es, proj_parm.en)", "shared_enfn(par.es, proj_parm.en)");
+            boost::replace_all(line, "pj_authset(par.es, proj_parm.apa)", "shared_authset(par.es, proj_parm.apa)");
+            boost::replace_all(line, "proj_mdist_ini(par.es, proj_parm.en)", "shared_mdist_ini(par.es, proj_parm.en)");
+        }
+    }
+
+    void dereference_mdist(std::vector<std::string>& lines)
+    {
+        // MDIST is a struct, passed by reference
+        BOOST_FOREACH(std::string& line, lines)
+        {
+            if (! boost::contains(line, "shared_mdist_ini"))
+            {
+                boost::replace_all(line, "this->m_proj_parm.en", "@en");
+                boost::replace_all(line, "proj_parm.en", "(*proj_parm.en)");
+                boost::replace_all(line, "@en", "(*this->m_proj_parm.en)");
+            }
+        }
+    }
+
+    void share_ellipsoid_tables()
+    {
+        // The series coefficients (en, apa, mdist) only depend on es. Instead of
+        // calculating them for each projection object, they are calculated once
+        // per es, and all projection objects refer to the same (constant) table
+
+        if (replace_table_declaration("double", "en[EN_SIZE]", "double const* en;"))
+        {
+            m_prop.shared_tables.insert("en");
+        }
+        if (replace_table_declaration("double", "apa[APA_SIZE]", "double const* apa;"))
+        {
+            m_prop.shared_tables.insert("apa");
+        }
+        if (replace_table_declaration("MDIST", "en", "MDIST const* en;"))
+        {
+            m_prop.shared_tables.insert("mdist");
+        }
+
+        if (! m_prop.shared_tables.empty())
+        {
+            for_each_line(&proj4_converter_cpp_bg::replace_table_initialization);
+        }
+        if (m_prop.shared_tables.count("mdist") > 0)
+        {
+            for_each_line(&proj4_converter_cpp_bg::dereference_mdist);
+        }
+    }
+
+    // The SPECIAL block of Proj4 (lcc, eqdc, ...) calculates some of the
+    // scale factors analytically. It is written as spc(), the writer
+    // completes the other factors numerically, and for projections
+    // without SPECIAL block all of them. The graticule of a conic is
+    // orthogonal: if h and k are analytic, so is thetap
+    void convert_scale_factors()
+    {
+        bool conic = false;
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            std::string line = der.raw_characteristics;
+            boost::replace_all(line, "\\t", " ");
+            boost::replace_all(line, "\\n", " ");
+            std::vector<std::string> terms;
+            split(line, terms, ", \"");
+            conic = conic || std::find(terms.begin(), terms.end(), "Conic") != terms.end();
+        }
+
+        int analytic = 0;
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            if (proj.direction != "special_factors")
+            {
+                continue;
+            }
+            bool hk = false;
+            BOOST_FOREACH(std::string& line, proj.lines)
+            {
+                boost::replace_all(line, "IS_ANAL_XL_YL", "analytic_xl_yl");
+                boost::replace_all(line, "IS_ANAL_XP_YP", "analytic_xp_yp");
+                boost::replace_all(line, "IS_ANAL_HK", "analytic_hk");
+                boost::replace_all(line, "IS_ANAL_CONV", "analytic_conv");
+                hk = hk || boost::contains(line, "analytic_hk");
+            }
+            if (conic && hk)
+            {
+                proj.lines.push_back(tab1 + "fac.thetap = geometry::math::half_pi<double>();");
+                proj.lines.push_back(tab1 + "fac.code |= analytic_thetap;");
+                m_prop.report["scale factors with analytic shape"]++;
+            }
+            analytic++;
+        }
+
+        std::set<std::string> models;
+        BOOST_FOREACH(projection const& proj, m_prop.projections)
+        {
+            models.insert(proj.subgroup + "_" + proj.model);
+        }
+        m_prop.report["scale factors analytic"] = analytic;
+        m_prop.report["scale factors numeric"] = int(models.size()) - analytic;
+
+        // The factors and their numeric completion, shared by all projections
+        m_prop.extra_impl_includes.insert("factors.hpp");
+    }
+
+    // Lets the writer transform grids faster than per point, where the
+    // forward allows it. Cylindricals are expected to be separable, if they
+    // are not (e.g. transverse or oblique) it is reported
+    void analyze_forward_grids()
+    {
+        std::set<std::string> pure;
+        BOOST_FOREACH(macro_or_const const& macro, m_prop.defined_macros)
+        {
+            std::string::size_type const open = macro.name.find('(');
+            if (open != std::string::npos)
+            {
+                // Written as functions taking const references
+                pure.insert(macro.name.substr(0, open));
+            }
+        }
+
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            if (proj.direction == "forward")
+            {
+                forward_grid_analyzer analyzer(proj, pure);
+                if (analyzer.apply())
+                {
+                    m_prop.report["forward grids " + proj.grid]++;
+                }
+            }
+        }
+
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            if (std::find(der.parsed_characteristics.begin(), der.parsed_characteristics.end(),
+                    "Cylindrical") == der.parsed_characteristics.end())
+            {
+                continue;
+            }
+            BOOST_FOREACH(model const& mod, der.models)
+            {
+                BOOST_FOREACH(projection const& proj, m_prop.projections)
+                {
+                    if (proj.direction == "forward" && proj.model == mod.name
+                        && proj.subgroup == mod.subgroup && proj.grid != "separable")
+                    {
+                        m_prop.report["forward grids cylindrical, not separable"]++;
+                    }
+                }
+            }
+        }
+    }
+
+    void localize_proj_parameters()
+    {
+        proj_parameter_localizer localizer(m_prop);
+        localizer.apply();
+    }
+
+    void precompute_invariants()
+    {
+        invariant_precomputer precomputer(m_prop);
+        m_prop.report["invariants precomputed"] = precomputer.apply();
+    }
+
+    void hoist_common_subexpressions()
+    {
+        // Members of proj_parm declared as double (also arrays of doubles)
+        std::set<std::string> double_members;
+        BOOST_FOREACH(std::string const& line, m_prop.proj_parameters)
+        {
+            if (boost::starts_with(boost::trim_copy(line), "double"))
+            {
+                std::vector<std::string> const names = extract_names(std::vector<std::string>(1, line));
+                double_members.insert(names.begin(), names.end());
+            }
+        }
+
+        int count = 0;
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            cse_hoister hoister(proj.lines, m_prop.report, double_members);
+            count += hoister.apply();
+        }
+        m_prop.report["cse hoisted"] = count;
+    }
+
+    // Parses a line like "sinphi = sin(lp_lat);" or "double c = cos(x);"
+    static bool parse_trig_assignment(std::string const& line, std::string& type,
+                std::string& name, std::string& function, std::string& argument)
+    {
+        std::string trimmed = boost::trim_copy(line);
+        type.clear();
+        char const* types[] = { "double const ", "double " };
+        for (std::size_t i = 0; i < 2 && type.empty(); i++)
+        {
+            if (boost::starts_with(trimmed, types[i]))
+            {
+                type = "double";
+                trimmed.erase(0, std::strlen(types[i]));
+            }
+        }
+
+        std::string::size_type const eq = trimmed.find("=");
+        if (eq == std::string::npos || ! boost::ends_with(trimmed, ");"))
+        {
+            return false;
+        }
+        name = boost::trim_copy(trimmed.substr(0, eq));
+        std::string rhs = boost::trim_copy(trimmed.substr(eq + 1));
+        if (! is_name(name)
+            || ! (boost::starts_with(rhs, "sin(") || boost::starts_with(rhs, "cos(")))
+        {
+            return false;
+        }
+        function = rhs.substr(0, 3);
+        argument = rhs.substr(4, rhs.size() - 6);
+
+        // The closing parenthesis should belong to sin/cos
+        int depth = 0;
+        for (std::string::size_type i = 0; i < argument.size(); i++)
+        {
+            depth += argument[i] == '(' ? 1 : argument[i] == ')' ? -1 : 0;
+            if (depth < 0)
+            {
+                return false;
+            }
+        }
+        return depth == 0 && ! argument.empty();
+    }
+
+    // Replaces sin and cos of the same argument, on adjacent lines, by one
+    // sincos call. Returns the number of fused pairs
+    int fuse_sincos(std::vector<std::string>& lines)
+    {
+        int count = 0;
+        for (std::size_t i = 0; i + 1 < lines.size(); i++)
+        {
+            std::string type1, name1, function1, argument1;
+            std::string type2, name2, function2, argument2;
+            if (! parse_trig_assignment(lines[i], type1, name1, function1, argument1)
+                || ! parse_trig_assignment(lines[i + 1], type2, name2, function2, argument2)
+                || function1 == function2
+                || type1 != type2
+                || name1 == name2
+                || boost::erase_all_copy(argument1, " ") != boost::erase_all_copy(argument2, " ")
+                || contains_name(argument1, name1))
+            {
+                continue;
+            }
+
+            std::string const& sin_name = function1 == "sin" ? name1 : name2;
+            std::string const& cos_name = function1 == "sin" ? name2 : name1;
+            std::string const indent = lines[i].substr(0, lines[i].find_first_not_of(" \t"));
+
+            lines[i + 1] = indent + "sincos(" + argument1 + ", " + sin_name + ", " + cos_name + ");";
+            if (type1.empty())
+            {
+                lines.erase(lines.begin() + i);
+            }
+            else
+            {
+                lines[i] = indent + type1 + " " + sin_name + ", " + cos_name + ";";
+                i++;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    void fuse_sincos()
+    {
+        int count = fuse_sincos(m_prop.inlined_functions);
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            count += fuse_sincos(proj.lines);
+        }
+        m_prop.report["sincos fused"] = count;
+
+        if (count > 0)
+        {
+            // Calculates both with one call if the C library provides sincos
+            std::string const lines[] =
+                {
+                    "inline void sincos(double x, double& s, double& c)",
+                    "{",
+                    "#if defined(__GLIBC__) && defined(_GNU_SOURCE)",
+                    tab1 + "::sincos(x, &s, &c);",
+                    "#else",
+                    tab1 + "s = sin(x);",
+                    tab1 + "c = cos(x);",
+                    "#endif",
+                    "}",
+                    "inline void sincos(float x, float& s, float& c)",
+                    "{",
+                    "#if defined(__GLIBC__) && defined(_GNU_SOURCE)",
+                    tab1 + "::sincosf(x, &s, &c);",
+                    "#else",
+                    tab1 + "s = sin(x);",
+                    tab1 + "c = cos(x);",
+                    "#endif",
+                    "}",
+                    "// Other calculation types (e.g. long double) calculate both separately",
+                    "template <typename T>",
+                    "inline void sincos(T const& x, T& s, T& c)",
+                    "{",
+                    tab1 + "using std::sin;",
+                    tab1 + "using std::cos;",
+                    tab1 + "s = sin(x);",
+                    tab1 + "c = cos(x);",
+                    "}",
+                    ""
+                };
+            m_prop.inlined_functions.insert(m_prop.inlined_functions.begin(),
+                    lines, lines + sizeof(lines) / sizeof(lines[0]));
+        }
+    }
+
+    // Returns the names of which the address is taken
+    static std::set<std::string> addressed_names(std::vector<std::string> const& code)
+    {
+        std::set<std::string> result;
+        BOOST_FOREACH(std::string const& line, code)
+        {
+            for (std::string::size_type j = 0; j + 1 < line.size(); j++)
+            {
+                if (line[j] == '&' && line[j + 1] != '&' && (j == 0 || line[j - 1] != '&'))
+                {
+                    std::string::size_type k = line.find_first_not_of(" (", j + 1);
+                    std::string name;
+                    while (k < line.size() && (std::isalnum(line[k]) || line[k] == '_'))
+                    {
+                        name += line[k++];
+                    }
+                    result.insert(name);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Returns true if the line declares double locals which can get the
+    // calculation type: no pointers, references, arrays, or addressed names
+    static bool is_calculation_declaration(std::string const& code,
+                std::set<std::string> const& addressed)
+    {
+        std::string const trimmed = boost::trim_copy(code);
+        if (! (boost::starts_with(trimmed, "double ")
+               || boost::starts_with(trimmed, "const double ")
+               || boost::starts_with(trimmed, "static const double ")))
+        {
+            return false;
+        }
+        // A single declarator (e.g. a hoisted expression) may have
+        // operators in its initializer
+        int depth = 0;
+        bool single = true;
+        for (std::string::size_type j = 0; j < trimmed.size(); j++)
+        {
+            char const c = trimmed[j];
+            depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+            single = single && ! (c == ',' && depth == 0);
+        }
+        std::string const declarator = single ? trimmed.substr(0, trimmed.find('=')) : trimmed;
+        if (declarator.find_first_of("*&[") != std::string::npos)
+        {
+            return false;
+        }
+        BOOST_FOREACH(std::string const& name, addressed)
+        {
+            if (contains_name(trimmed, name))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Replaces floating point literals by CalculationType(literal), and
+    // tolerances by tolerance<CalculationType>(name), from the back such
+    // that positions stay valid. Returns the number of literals replaced
+    static int replace_literals(std::string const& code, std::string& line,
+                std::set<std::string> const& tolerances)
+    {
+        int count = 0;
+        std::string::size_type j = code.size();
+        while (j > 0)
+        {
+            j--;
+            if (! (std::isdigit(code[j]) || code[j] == '.' || code[j] == '_' || std::isalpha(code[j])))
+            {
+                continue;
+            }
+
+            // Find the begin of the word or number
+            std::string::size_type begin = j;
+            while (begin > 0
+                && (std::isalnum(code[begin - 1]) || code[begin - 1] == '_' || code[begin - 1] == '.'
+                    || ((code[begin - 1] == '+' || code[begin - 1] == '-') && begin > 1
+                        && (code[begin - 2] == 'e' || code[begin - 2] == 'E')
+                        && begin > 2 && (std::isdigit(code[begin - 3]) || code[begin - 3] == '.'))))
+            {
+                begin--;
+            }
+            std::string const word = code.substr(begin, j + 1 - begin);
+            j = begin;
+
+            bool const numeric = std::isdigit(word[0])
+                || (word[0] == '.' && word.size() > 1 && std::isdigit(word[1]));
+            bool const floating = numeric
+                && ! boost::starts_with(word, "0x") && ! boost::starts_with(word, "0X")
+                && word.find_first_of(".eE") != std::string::npos
+                && word.find_first_of("fFlL") == std::string::npos;
+            bool const in_string = std::count(code.begin(), code.begin() + begin, '"') % 2 == 1;
+            if (floating && ! in_string)
+            {
+                line.replace(begin, word.size(), "CalculationType(" + word + ")");
+                count++;
+            }
+            else if (tolerances.count(word) > 0 && ! in_string
+                && (begin == 0 || code[begin - 1] != '.'))
+            {
+                line.replace(begin, word.size(), "tolerance<CalculationType>(" + word + ")");
+            }
+        }
+        return count;
+    }
+
+    // Returns the names of the constants used as tolerance (EPS10, TOL, ...)
+    // which are too small to be reached in float
+    std::set<std::string> tolerance_constants() const
+    {
+        std::set<std::string> result;
+        BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+        {
+            if (! boost::contains(con.name, "EPS") && ! boost::contains(con.name, "TOL"))
+            {
+                continue;
+            }
+            try
+            {
+                double const value = boost::lexical_cast<double>(boost::trim_copy(con.value));
+                if (value > 0.0 && value < 1.0e-5)
+                {
+                    result.insert(con.name);
+                }
+            }
+            catch (boost::bad_lexical_cast const&)
+            {
+            }
+        }
+        return result;
+    }
+
+    // Names of which reads are double in the forward and inverse:
+    // members of par and proj_parm, constants, locals which keep double,
+    // and functions returning double. Structures (proj_parm members),
+    // tables (constants) and struct locals are of types with double members
+    struct double_names
+    {
+        std::set<std::string> par, scalars, arrays, constants, locals, functions;
+        std::set<std::string> types, structures, tables, struct_locals, struct_functions;
+        std::set<std::string> member_scalars, member_arrays;
+    };
+
+    // Returns the double names, except locals which are found per function
+    double_names collect_double_names(std::set<std::string> const& tolerances) const
+    {
+        double_names result;
+
+        std::string const par[] = { "a", "e", "es", "ra", "one_es", "rone_es",
+            "lam0", "phi0", "x0", "y0", "k0", "to_meter", "fr_meter" };
+        result.par.insert(boost::begin(par), boost::end(par));
+
+        // Structs with double members, e.g. the coefficients of robin
+        std::vector<std::string> definitions = blank_comments(m_prop.extra_structs);
+        std::vector<std::string> const inlined = blank_comments(m_prop.inlined_functions);
+        definitions.insert(definitions.end(), inlined.begin(), inlined.end());
+        std::set<std::string>& types = result.types;
+        std::string current;
+        BOOST_FOREACH(std::string const& definition, definitions)
+        {
+            std::string line = boost::trim_copy(definition);
+            if (boost::starts_with(line, "struct "))
+            {
+                std::vector<std::string> words;
+                split(line.substr(0, line.find('{')), words, " ");
+                current = words.back();
+                line = line.find('{') == std::string::npos ? "" : line.substr(line.find('{') + 1);
+                boost::trim(line);
+            }
+            if (current.empty())
+            {
+                std::vector<std::string> words;
+                split(line, words, " =");
+                if (words.size() >= 4 && words[0] == "static" && words[1] == "const"
+                    && types.count(words[2]) > 0)
+                {
+                    result.tables.insert(words[3]);
+                }
+                continue;
+            }
+            if (boost::starts_with(line, "double "))
+            {
+                std::vector<std::string> declarators;
+                split(line.substr(7, line.find(';') - 7), declarators, ",");
+                BOOST_FOREACH(std::string const& declarator, declarators)
+                {
+                    std::string const name = boost::trim_copy(declarator.substr(0, declarator.find('[')));
+                    (boost::contains(declarator, "[") ? result.member_arrays : result.member_scalars).insert(name);
+                }
+                types.insert(current);
+            }
+            if (boost::contains(line, "}"))
+            {
+                current.clear();
+            }
+        }
+
+        BOOST_FOREACH(std::string const& declaration, m_prop.proj_parameters)
+        {
+            std::string line = declaration;
+            strip_comments(line);
+            boost::trim(line);
+            std::vector<std::string> words;
+            split(line, words, " ");
+            if (words.size() == 2 && types.count(words[0]) > 0)
+            {
+                result.structures.insert(words[1].substr(0, words[1].find_first_of("[;")));
+            }
+            if (! boost::starts_with(line, "double") || ! boost::ends_with(line, ";"))
+            {
+                continue;
+            }
+            std::vector<std::string> declarators;
+            split(line.substr(6, line.size() - 7), declarators, ",");
+            BOOST_FOREACH(std::string const& declarator, declarators)
+            {
+                // Elements of arrays and pointers (e.g. en) are read, not the array
+                std::string name = declarator;
+                boost::replace_all(name, "const", "");
+                boost::erase_all(name, "*");
+                name = boost::trim_copy(name.substr(0, name.find('[')));
+                bool const array = declarator.find_first_of("*[") != std::string::npos;
+                (array ? result.arrays : result.scalars).insert(name);
+            }
+        }
+
+        BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+        {
+            if (con.type == "double" && tolerances.count(con.name) == 0)
+            {
+                result.constants.insert(con.name);
+            }
+        }
+        result.constants.insert("FORTPI");
+
+        std::string const library[] = { "pj_tsfn", "pj_phi2", "pj_msfn", "pj_qsfn",
+            "pj_mlfn", "pj_inv_mlfn", "pj_authlat", "proj_mdist", "proj_inv_mdist",
+            "aasin", "aacos", "asqrt", "aatan2", "adjlon" };
+        result.functions.insert(boost::begin(library), boost::end(library));
+
+        BOOST_FOREACH(macro_or_const const& macro, m_prop.defined_macros)
+        {
+            std::string::size_type const open = macro.name.find('(');
+            if (open != std::string::npos && macro.type == "double")
+            {
+                result.functions.insert(macro.name.substr(0, open));
+            }
+        }
+
+        // Definitions as "static double gatg(...)", or with the name on the next line
+        for (std::size_t i = 0; i < inlined.size(); i++)
+        {
+            std::string const trimmed = boost::trim_copy(inlined[i]);
+            bool const definition = boost::starts_with(trimmed, "static ")
+                || boost::starts_with(trimmed, "inline ") || boost::starts_with(trimmed, "double ");
+            std::string::size_type pos = find_name(trimmed, "double");
+            if (! definition || pos == std::string::npos || boost::ends_with(trimmed, ";"))
+            {
+                continue;
+            }
+            std::string rest = boost::trim_copy(trimmed.substr(pos + 6));
+            if (rest.empty() && i + 1 < inlined.size())
+            {
+                rest = boost::trim_copy(inlined[i + 1]);
+            }
+            std::string::size_type const open = rest.find('(');
+            if (open != std::string::npos && is_name(boost::trim_copy(rest.substr(0, open))))
+            {
+                result.functions.insert(boost::trim_copy(rest.substr(0, open)));
+            }
+        }
+
+        // Functions returning a struct with double members (e.g. isea_forward),
+        // their results cannot be converted as a whole
+        std::string const joined = boost::join(inlined, " ");
+        BOOST_FOREACH(std::string const& type, types)
+        {
+            std::string::size_type pos = find_name(joined, type);
+            while (pos != std::string::npos)
+            {
+                std::string::size_type const begin = joined.find_first_not_of(' ', pos + type.size());
+                std::string::size_type end = begin;
+                while (end < joined.size() && (std::isalnum(joined[end]) || joined[end] == '_'))
+                {
+                    end++;
+                }
+                std::string::size_type const next = joined.find_first_not_of(' ', end);
+                if (end > begin && next != std::string::npos && joined[next] == '(')
+                {
+                    result.struct_functions.insert(joined.substr(begin, end - begin));
+                }
+                pos = find_name(joined, type, pos + type.size());
+            }
+        }
+        return result;
+    }
+
+    // Splits declarations of double locals of which only some are addressed
+    // (e.g. passed as a pointer), such that the others can get the calculation type
+    static void split_addressed_declarations(std::vector<std::string>& lines)
+    {
+        std::vector<std::string> const code = blank_comments(lines);
+        std::set<std::string> const addressed = addressed_names(code);
+        for (std::size_t i = code.size(); i > 0; i--)
+        {
+            std::string const trimmed = boost::trim_copy(code[i - 1]);
+            if (code[i - 1] != lines[i - 1]
+                || ! boost::starts_with(trimmed, "double ")
+                || ! boost::ends_with(trimmed, ";")
+                || trimmed.find_first_of("=*&[(") != std::string::npos)
+            {
+                continue;
+            }
+            std::vector<std::string> names;
+            split(trimmed.substr(7, trimmed.size() - 8), names, ", ");
+            std::string free, kept;
+            BOOST_FOREACH(std::string const& name, names)
+            {
+                std::string& target = addressed.count(name) > 0 ? kept : free;
+                target += (target.empty() ? "" : ", ") + name;
+            }
+            if (! free.empty() && ! kept.empty())
+            {
+                std::string const indent = code[i - 1].substr(0, code[i - 1].find_first_not_of(" \t"));
+                lines[i - 1] = indent + "double " + free + ";";
+                lines.insert(lines.begin() + i, indent + "double " + kept + ";");
+            }
+        }
+    }
+
+    // Adds the locals of a struct type with double members, declared by this line
+    static void add_struct_locals(std::string const& trimmed, double_names& doubles)
+    {
+        std::vector<std::string> words;
+        split(trimmed, words, " ;");
+        if (! words.empty() && words[0] == "struct")
+        {
+            words.erase(words.begin());
+        }
+        if (words.size() == 2 && doubles.types.count(words[0]) > 0 && is_name(words[1]))
+        {
+            doubles.struct_locals.insert(words[1]);
+        }
+    }
+
+    // Adds the scalar locals declared as double by this line to the set
+    static void add_double_locals(std::string const& trimmed, std::set<std::string>& locals)
+    {
+        if (! boost::starts_with(trimmed, "double "))
+        {
+            return;
+        }
+        std::vector<std::string> declarators;
+        split(trimmed.substr(7, trimmed.find_last_of(';') - 7), declarators, ",");
+        BOOST_FOREACH(std::string const& declarator, declarators)
+        {
+            std::string const name = boost::trim_copy(declarator.substr(0, declarator.find('=')));
+            if (is_name(name))
+            {
+                locals.insert(name);
+            }
+        }
+    }
+
+    // Returns true if the value between begin and end is read: not assigned,
+    // incremented, addressed, or already converted
+    static bool is_read(std::string const& code, std::string::size_type begin,
+                std::string::size_type end)
+    {
+        std::string::size_type const next = code.find_first_not_of(" \n", end);
+        std::string const after = next == std::string::npos ? "" : code.substr(next, 2);
+        if ((! after.empty() && after[0] == '=' && after != "==")
+            || after == "+=" || after == "-=" || after == "*=" || after == "/="
+            || after == "++" || after == "--")
+        {
+            return false;
+        }
+        std::string const before = boost::trim_right_copy(code.substr(0, begin));
+        return ! boost::ends_with(before, "&")
+            && ! boost::ends_with(before, "++")
+            && ! boost::ends_with(before, "--")
+            && ! boost::ends_with(before, "CalculationType(")
+            && ! boost::ends_with(before, "_type(");
+    }
+
+    // Returns the end of a read of a double member of a struct, starting at
+    // pos with its indices and/or members (e.g. ".c0[i]" or "[z-1].lam0"),
+    // or npos if it is not double
+    static std::string::size_type double_member_end(std::string const& code,
+                std::string::size_type pos, double_names const& doubles)
+    {
+        std::string member;
+        bool indexed = false;
+        while (pos < code.size() && (code[pos] == '[' || code[pos] == '.'))
+        {
+            if (code[pos] == '[')
+            {
+                pos = code.find(']', pos);
+                if (pos == std::string::npos)
+                {
+                    return pos;
+                }
+                pos++;
+                indexed = true;
+            }
+            else
+            {
+                std::string::size_type const begin = ++pos;
+                while (pos < code.size() && (std::isalnum(code[pos]) || code[pos] == '_'))
+                {
+                    pos++;
+                }
+                member = code.substr(begin, pos - begin);
+                indexed = false;
+            }
+        }
+        bool const read = indexed
+            ? doubles.member_arrays.count(member) > 0
+            : doubles.member_scalars.count(member) > 0;
+        return read ? pos : std::string::npos;
+    }
+
+    // Wraps reads of double values in CalculationType(...), in the line and in
+    // its blanked copy, such that a float kernel is not promoted to double.
+    // Arguments of calls returning double are left as they are, such calls
+    // calculate in double. Their names are added to called.
+    // Returns the number of reads wrapped
+    static int narrow_double_reads(std::string& code, std::string& line,
+                double_names const& doubles, std::set<std::string>& called)
+    {
+        int count = 0;
+        std::string::size_type j = 0;
+        while (j < code.size())
+        {
+            if (! (std::isalpha(code[j]) || code[j] == '_')
+                || (j > 0 && (std::isalnum(code[j - 1]) || code[j - 1] == '_')))
+            {
+                j++;
+                continue;
+            }
+            std::string::size_type end = j;
+            while (end < code.size() && (std::isalnum(code[end]) || code[end] == '_'))
+            {
+                end++;
+            }
+            std::string const word = code.substr(j, end - j);
+            std::string::size_type const begin = j;
+            std::string const before = code.substr(0, begin);
+            bool const in_string = std::count(code.begin(), code.begin() + begin, '"') % 2 == 1;
+            bool wrap = false, call = false;
+
+            std::string const prefixes[] = { "this->m_par.", "this->m_proj_parm." };
+            if (word == "this" && ! in_string)
+            {
+                for (int p = 0; p < 2 && ! wrap; p++)
+                {
+                    if (code.compare(begin, prefixes[p].size(), prefixes[p]) != 0)
+                    {
+                        continue;
+                    }
+                    std::string::size_type m = begin + prefixes[p].size();
+                    end = m;
+                    while (end < code.size() && (std::isalnum(code[end]) || code[end] == '_'))
+                    {
+                        end++;
+                    }
+                    std::string const member = code.substr(m, end - m);
+                    if (p == 0 ? doubles.par.count(member) > 0 : doubles.scalars.count(member) > 0)
+                    {
+                        wrap = true;
+                    }
+                    else if (p == 1 && doubles.arrays.count(member) > 0
+                        && end < code.size() && code[end] == '[')
+                    {
+                        // Element read, possibly of more dimensions
+                        wrap = true;
+                        while (wrap && end < code.size() && code[end] == '[')
+                        {
+                            std::string::size_type const close = code.find(']', end);
+                            wrap = close != std::string::npos;
+                            end = close + 1;
+                        }
+                    }
+                    else if (p == 1 && doubles.structures.count(member) > 0)
+                    {
+                        end = double_member_end(code, end, doubles);
+                        wrap = end != std::string::npos;
+                    }
+                }
+            }
+            else if (! in_string && ! boost::ends_with(before, ".") && ! boost::ends_with(before, "->"))
+            {
+                std::string::size_type const next = code.find_first_not_of(" \n", end);
+                bool const followed_by_call = next != std::string::npos && code[next] == '(';
+                if (followed_by_call && doubles.functions.count(word) > 0)
+                {
+                    std::string::size_type const close = closing(code, next);
+                    if (close != std::string::npos)
+                    {
+                        end = close + 1;
+                        wrap = call = true;
+                    }
+                }
+                else if (! followed_by_call
+                    && (doubles.constants.count(word) > 0 || doubles.locals.count(word) > 0))
+                {
+                    wrap = true;
+                }
+                else if (doubles.tables.count(word) > 0 || doubles.struct_locals.count(word) > 0)
+                {
+                    end = double_member_end(code, end, doubles);
+                    wrap = end != std::string::npos;
+                }
+                else if (followed_by_call && doubles.struct_functions.count(word) > 0)
+                {
+                    called.insert(word);
+                }
+            }
+
+            if (wrap && is_read(code, begin, end))
+            {
+                if (call)
+                {
+                    called.insert(word);
+                }
+                code.insert(end, ")");
+                line.insert(end, ")");
+                code.insert(begin, "CalculationType(");
+                line.insert(begin, "CalculationType(");
+                j = end + 17;
+                count++;
+            }
+            else
+            {
+                // Proceed within, e.g. into the arguments of a call
+                j = begin + word.size();
+            }
+        }
+        return count;
+    }
+
+    // Lets forward, inverse and the analytic scale factors calculate in
+    // CalculationType: double locals, floating point literals and constants
+    // get that type, and reads of double parameters, constants and results
+    // are converted to it, such that a float instantiation does not promote
+    // to double. For double nothing changes.
+    // Tolerances are guarded, in float they are at least a few epsilons,
+    // otherwise iterations might never converge
+    void use_calculation_type()
+    {
+        std::set<std::string> const tolerances = tolerance_constants();
+        double_names doubles = collect_double_names(tolerances);
+        std::set<std::string> called;
+        int locals = 0, literals = 0, guarded = 0, narrowed = 0;
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            if (proj.direction != "forward" && proj.direction != "inverse"
+                && proj.direction != "special_factors")
+            {
+                continue;
+            }
+            split_addressed_declarations(proj.lines);
+            std::vector<std::string> code = blank_comments(proj.lines);
+            std::set<std::string> const addressed = addressed_names(code);
+            doubles.locals.clear();
+            doubles.struct_locals.clear();
+            bool skip = false;
+            std::size_t narrowed_until = 0;
+            for (std::size_t i = 0; i < code.size(); i++)
+            {
+                std::string& line = proj.lines[i];
+                std::string const trimmed = boost::trim_copy(code[i]);
+                if (boost::starts_with(trimmed, "#"))
+                {
+                    continue;
+                }
+                bool const declaration = is_calculation_declaration(code[i], addressed);
+                add_struct_locals(trimmed, doubles);
+                if (! declaration && (boost::starts_with(trimmed, "double ")
+                    || boost::contains(trimmed, " double ")))
+                {
+                    // Other double declarations (e.g. tables) keep their literals
+                    skip = true;
+                    add_double_locals(trimmed, doubles.locals);
+                }
+
+                if (! skip)
+                {
+                    std::string const before = line;
+                    if (i >= narrowed_until)
+                    {
+                        // Calls might continue on the next lines, which are
+                        // therefore narrowed together with this line
+                        std::size_t last = i;
+                        std::string joined_code = code[i], joined_line = line;
+                        long depth = std::count(code[i].begin(), code[i].end(), '(')
+                            - std::count(code[i].begin(), code[i].end(), ')');
+                        while (depth > 0 && last + 1 < code.size())
+                        {
+                            last++;
+                            depth += std::count(code[last].begin(), code[last].end(), '(')
+                                - std::count(code[last].begin(), code[last].end(), ')');
+                            joined_code += "\n" + code[last];
+                            joined_line += "\n" + proj.lines[last];
+                        }
+                        narrowed += narrow_double_reads(joined_code, joined_line, doubles, called);
+                        std::vector<std::string> code_parts, line_parts;
+                        boost::split(code_parts, joined_code, boost::is_any_of("\n"));
+                        boost::split(line_parts, joined_line, boost::is_any_of("\n"));
+                        std::copy(code_parts.begin(), code_parts.end(), code.begin() + i);
+                        std::copy(line_parts.begin(), line_parts.end(), proj.lines.begin() + i);
+                        narrowed_until = last + 1;
+                    }
+                    literals += replace_literals(code[i], line, tolerances);
+                    if (boost::contains(line, "tolerance<") && ! boost::contains(before, "tolerance<"))
+                    {
+                        guarded++;
+                    }
+                    boost::replace_all(line, "<double>()", "<CalculationType>()");
+                }
+                if (declaration)
+                {
+                    std::string::size_type const pos = line.find("double");
+                    line.replace(pos, 6, "CalculationType");
+                    locals++;
+                }
+                if (skip && boost::ends_with(trimmed, ";"))
+                {
+                    skip = false;
+                }
+            }
+        }
+        m_prop.report["calculation type locals"] = locals;
+        m_prop.report["calculation type literals"] = literals;
+        m_prop.report["calculation type narrowed"] = narrowed;
+        m_prop.double_calculations = called;
+
+        if (guarded > 0)
+        {
+            std::string const helper[] =
+                {
+                    "// Returns the tolerance, for float not smaller than a few epsilons",
+                    "template <typename T>",
+                    "inline T tolerance(double value)",
+                    "{",
+                    tab1 + "return value;",
+                    "}",
+                    "template <>",
+                    "inline float tolerance<float>(double value)",
+                    "{",
+                    tab1 + "return (std::max)(float(value), 4 * std::numeric_limits<float>::epsilon());",
+                    "}",
+                    ""
+                };
+            m_prop.inlined_functions.insert(m_prop.inlined_functions.begin(),
+                boost::begin(helper), boost::end(helper));
+            m_prop.extra_includes.insert("limits");
+            m_prop.report["tolerances guarded"] = guarded;
+        }
+    }
+
+    // Lets forward and inverse use the mode (N_POLE, S_POLE, EQUIT, OBLIQ)
+    // via mode(), which the writer returns as a template parameter if it is
+    // known at compile time, resolving the switches on it
+    void specialize_modes()
+    {
+        bool has_mode = false;
+        BOOST_FOREACH(std::string const& line, m_prop.proj_parameters)
+        {
+            std::vector<std::string> words;
+            split(line, words, " \t");
+            if (words.size() == 2u && words[0] == "int" && words[1] == "mode;")
+            {
+                has_mode = true;
+            }
+        }
+        if (! has_mode || ! m_prop.link_type.empty())
+        {
+            return;
+        }
+
+        // The values are the integer constants assigned by the setup
+        std::vector<std::string> setup_lines = m_prop.setup_functions;
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            setup_lines.insert(setup_lines.end(), der.constructor_lines.begin(), der.constructor_lines.end());
+        }
+        std::vector<std::string> values;
+        BOOST_FOREACH(std::string const& line, setup_lines)
+        {
+            if (! boost::contains(line, "proj_parm.mode ="))
+            {
+                continue;
+            }
+            bool found = false;
+            BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+            {
+                if (con.type == "int" && contains_name(line, con.name))
+                {
+                    found = true;
+                    if (std::find(values.begin(), values.end(), con.name) == values.end())
+                    {
+                        values.push_back(con.name);
+                    }
+                }
+            }
+            if (! found)
+            {
+                // Assigned otherwise, the values are not known
+                return;
+            }
+        }
+        if (values.empty())
+        {
+            return;
+        }
+
+        int count = 0;
+        BOOST_FOREACH(projection const& proj, m_prop.projections)
+        {
+            BOOST_FOREACH(std::string const& line, proj.lines)
+            {
+                if (boost::contains(line, "m_proj_parm.mode =")
+                    && ! boost::contains(line, "m_proj_parm.mode =="))
+                {
+                    // Modified by forward/inverse
+                    return;
+                }
+            }
+        }
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            if (proj.direction != "forward" && proj.direction != "inverse")
+            {
+                continue;
+            }
+            BOOST_FOREACH(std::string& line, proj.lines)
+            {
+                if (boost::contains(line, "this->m_proj_parm.mode"))
+                {
+                    boost::replace_all(line, "this->m_proj_parm.mode", "this->mode()");
+                    count++;
+                }
+            }
+        }
+
+        if (count > 0)
+        {
+            // Sorted on value, such that the factory lists them in order
+            std::vector<std::string> sorted;
+            BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+            {
+                if (std::find(values.begin(), values.end(), con.name) != values.end())
+                {
+                    sorted.push_back(con.name);
+                }
+            }
+            m_prop.mode_values = sorted;
+            m_prop.extra_includes.insert("boost/assert.hpp");
+            m_prop.report["mode switches specialized"] = count;
+        }
+    }
+
+    // Reports which setup functions could be evaluated at compile time,
+    // for EPSG codes with all parameters known, and what prevents that
+    void report_constexpr_setup()
+    {
+        char const* math[] = { "sin", "cos", "tan", "asin", "acos", "atan",
+            "atan2", "sqrt", "log", "log10", "exp", "pow", "fabs", "hypot",
+            "sinh", "cosh", "tanh", "floor", "ceil", "fmod", "aasin", "aacos",
+            "aatan2", "asqrt", "adjlon" };
+        std::set<std::string> const math_functions(math, math + sizeof(math) / sizeof(math[0]));
+
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            std::vector<std::string> lines = der.constructor_lines;
+            lines.insert(lines.end(), m_prop.setup_functions.begin(), m_prop.setup_functions.end());
+
+            std::set<std::string> reasons;
+            BOOST_FOREACH(std::string const& line, lines)
+            {
+                if (boost::contains(line, " new ") || boost::starts_with(boost::trim_copy(line), "new "))
+                {
+                    reasons.insert("allocation");
+                }
+                BOOST_FOREACH(std::string const& function, called_functions(line))
+                {
+                    std::string const name = boost::starts_with(function, "std::")
+                        ? function.substr(5) : function;
+                    if (name == "pj_param")
+                    {
+                        reasons.insert("parameter lookup");
+                    }
+                    else if (math_functions.count(name) > 0)
+                    {
+                        reasons.insert("math functions");
+                    }
+                    else if (boost::starts_with(name, "pj_"))
+                    {
+                        reasons.insert("library functions");
+                    }
+                }
+            }
+
+            if (reasons.empty())
+            {
+                m_prop.report["constexpr setup candidates"]++;
+            }
+            BOOST_FOREACH(std::string const& reason, reasons)
+            {
+                m_prop.report["constexpr setup prevented by " + reason]++;
+            }
+        }
+    }
+
+    // Replaces the pj_param searches of setup functions, looking up each
+    // parameter in the whole list, by the typed fields of a struct filled
+    // in one pass over the list
+    void index_parameter_lookups()
+    {
+        int count = 0;
+        BOOST_FOREACH(derived& der, m_prop.derived_projections)
+        {
+            count += index_parameter_lookups(der.constructor_lines, "param_lookup_" + der.name);
+        }
+        count += index_parameter_lookups(m_prop.setup_functions, "param_lookup_setup");
+        if (count > 0)
+        {
+            m_prop.report["parameter lookups indexed"] = count;
+        }
+    }
+
+    int index_parameter_lookups(std::vector<std::string>& lines, std::string const& struct_name)
+    {
+        std::string const tag = "pj_param(par.params, \"";
+
+        // Collect the parameter names, with their types (t: exists, i: int,
+        // b: boolean, d: double, r: radians, s: string), in order
+        std::vector<std::string> names;
+        std::vector<std::string> fields;
+        int calls = 0;
+        BOOST_FOREACH(std::string const& line, lines)
+        {
+            std::string::size_type pos = line.find(tag);
+            while (pos != std::string::npos)
+            {
+                std::string::size_type const begin = pos + tag.size();
+                std::string::size_type const end = line.find("\").", begin);
+                if (end == std::string::npos || end - begin < 2)
+                {
+                    return 0;
+                }
+                char const type = line[begin];
+                std::string const name = line.substr(begin + 1, end - begin - 1);
+                char const accessor = end + 3 < line.size() ? line[end + 3] : ' ';
+                char const expected = type == 's' ? 's'
+                    : type == 'd' || type == 'r' ? 'f'
+                    : type == 't' || type == 'i' || type == 'b' ? 'i'
+                    : ' ';
+                if (! is_name(name) || accessor != expected)
+                {
+                    return 0;
+                }
+                if (std::find(names.begin(), names.end(), name) == names.end())
+                {
+                    names.push_back(name);
+                }
+                std::string const field = std::string(1, type) + name;
+                if (std::find(fields.begin(), fields.end(), field) == fields.end())
+                {
+                    fields.push_back(field);
+                }
+                calls++;
+                pos = line.find(tag, end);
+            }
+        }
+        if (calls < 2)
+        {
+            // A single search is not slower than one pass
+            return 0;
+        }
+
+        // Replace the searches by the fields (e.g. lat_ts_r for "rlat_ts")
+        BOOST_FOREACH(std::string& line, lines)
+        {
+            BOOST_FOREACH(std::string const& field, fields)
+            {
+                char const type = field[0];
+                std::string const accessor = type == 's' ? ".s"
+                    : type == 'd' || type == 'r' ? ".f" : ".i";
+                boost::replace_all(line, tag + field + "\")" + accessor,
+                    "lookup." + field.substr(1) + "_" + type);
+            }
+        }
+        lines.insert(lines.begin(), tab1 + struct_name + " const lookup(par);");
+
+        // Add the struct, filling each field on the first occurrence of the
+        // parameter only, converting its value as pj_param does
+        std::vector<std::string> code;
+        code.push_back("// Parameters used by the setup, looked up in one pass");
+        code.push_back("struct " + struct_name);
+        code.push_back("{");
+        std::string initialization;
+        BOOST_FOREACH(std::string const& field, fields)
+        {
+            char const type = field[0];
+            std::string const member = field.substr(1) + "_" + type;
+            code.push_back(tab1 + (type == 's' ? "std::string"
+                    : type == 'd' || type == 'r' ? "double" : "int")
+                + " " + member + ";");
+            if (type != 's')
+            {
+                initialization += std::string(initialization.empty() ? ": " : ", ")
+                    + member + "(0)";
+            }
+        }
+        code.push_back("");
+        code.push_back(tab1 + "template <typename Parameters>");
+        code.push_back(tab1 + "inline explicit " + struct_name + "(Parameters const& par)");
+        if (! initialization.empty())
+        {
+            code.push_back(tab2 + initialization);
+        }
+        code.push_back(tab1 + "{");
+        BOOST_FOREACH(std::string const& name, names)
+        {
+            code.push_back(tab2 + "bool " + name + "_found = false;");
+        }
+        code.push_back(tab2 + "for (std::vector<pvalue>::const_iterator it = par.params.begin(); it != par.params.end(); ++it)");
+        code.push_back(tab2 + "{");
+        BOOST_FOREACH(std::string const& name, names)
+        {
+            code.push_back(tab3 + "if (! " + name + "_found && it->param == \"" + name + "\")");
+            code.push_back(tab3 + "{");
+            BOOST_FOREACH(std::string const& field, fields)
+            {
+                if (field.substr(1) == name)
+                {
+                    char const type = field[0];
+                    code.push_back(tab4 + name + "_" + type + " = " + parameter_conversion(type) + ";");
+                }
+            }
+            code.push_back(tab4 + name + "_found = true;");
+            code.push_back(tab3 + "}");
+        }
+        code.push_back(tab2 + "}");
+        code.push_back(tab1 + "}");
+        code.push_back("};");
+        code.push_back("");
+        m_prop.inlined_functions.insert(m_prop.inlined_functions.end(), code.begin(), code.end());
+
+        return calls;
+    }
+
+    // Returns the conversion of the value of the parameter at "it" to its
+    // type, as pj_param does, without copying it into a list of its own
+    std::string parameter_conversion(char type)
+    {
+        switch (type)
+        {
+            case 't' : return "1";
+            case 's' : return "it->s";
+            case 'b' : return "it->s.empty() || it->s[0] == 'T' || it->s[0] == 't'";
+            case 'r' :
+                m_prop.extra_impl_includes.insert("dms_parser.hpp");
+                return "dms_parser<true, double>().apply(it->s.c_str()).angle()";
+        }
+        m_prop.extra_includes.insert("cstdlib");
+        return type == 'd'
+            ? "std::atof(it->s.c_str())"
+            : "std::atoi(it->s.c_str())";
+    }
+
+    // A declaration of par_<group>, with its comment lines, and its usage
+    struct member_usage
+    {
+        std::vector<std::string> lines;
+        int uses;
+    };
+
+    // Orders the members of par_<group> on their usage in forward/inverse,
+    // such that the members used in each call share as few cache lines as
+    // possible, and the members used by setup only come last
+    void order_proj_parameters()
+    {
+        std::vector<member_usage> members;
+        std::vector<std::string> const code = blank_comments(m_prop.proj_parameters);
+        std::vector<std::string> comments;
+        for (std::size_t i = 0; i < code.size(); i++)
+        {
+            std::string const declaration = boost::trim_copy(code[i]);
+            if (declaration.empty())
+            {
+                if (! boost::trim_copy(m_prop.proj_parameters[i]).empty())
+                {
+                    comments.push_back(m_prop.proj_parameters[i]);
+                }
+                continue;
+            }
+            std::vector<std::string> names;
+            if (! declared_names(declaration, names))
+            {
+                // Not only data members (e.g. functions or constructors)
+                return;
+            }
+
+            member_usage m;
+            m.lines = comments;
+            m.lines.push_back(m_prop.proj_parameters[i]);
+            m.uses = 0;
+            BOOST_FOREACH(projection const& proj, m_prop.projections)
+            {
+                if (proj.direction != "forward" && proj.direction != "inverse")
+                {
+                    continue;
+                }
+                BOOST_FOREACH(std::string const& line, proj.lines)
+                {
+                    BOOST_FOREACH(std::string const& name, names)
+                    {
+                        std::string const used = "m_proj_parm." + name;
+                        for (std::string::size_type loc = find_name(line, used);
+                            loc != std::string::npos;
+                            loc = find_name(line, used, loc + used.size()))
+                        {
+                            m.uses++;
+                        }
+                    }
+                }
+            }
+            members.push_back(m);
+            comments.clear();
+        }
+
+        // Most used first, setup only last, otherwise in the original order
+        std::vector<member_usage> ordered;
+        std::vector<bool> done(members.size(), false);
+        int cold = 0;
+        while (ordered.size() < members.size())
+        {
+            std::size_t best = members.size();
+            for (std::size_t i = 0; i < members.size(); i++)
+            {
+                if (! done[i] && (best == members.size() || members[i].uses > members[best].uses))
+                {
+                    best = i;
+                }
+            }
+            done[best] = true;
+            ordered.push_back(members[best]);
+            if (members[best].uses == 0)
+            {
+                cold++;
+            }
+        }
+
+        bool changed = false;
+        for (std::size_t i = 0; i < members.size(); i++)
+        {
+            if (members[i].lines != ordered[i].lines)
+            {
+                changed = true;
+            }
+        }
+        if (! changed)
+        {
+            return;
+        }
+
+        std::vector<std::string> result;
+        BOOST_FOREACH(member_usage const& m, ordered)
+        {
+            if (m.uses == 0 && cold > 0)
+            {
+                result.push_back("// used in setup only");
+                cold = 0;
+            }
+            result.insert(result.end(), m.lines.begin(), m.lines.end());
+        }
+        result.insert(result.end(), comments.begin(), comments.end());
+        m_prop.proj_parameters = result;
+        m_prop.report["proj parameters reordered"] = static_cast<int>(members.size());
+    }
+
+    // Returns the names declared by a data member declaration, like
+    // "double n, *en, c[6];" or "struct isea_dgg dgg;"
+    static bool declared_names(std::string const& declaration, std::vector<std::string>& names)
+    {
+        if (! boost::ends_with(declaration, ";")
+            || declaration.find_first_of("(){}=\"") != std::string::npos
+            || std::count(declaration.begin(), declaration.end(), ';') != 1
+            || boost::starts_with(declaration, "static ")
+            || boost::starts_with(declaration, "typedef ")
+            || boost::starts_with(declaration, "template"))
+        {
+            return false;
+        }
+
+        std::vector<std::string> declarators;
+        split(declaration.substr(0, declaration.size() - 1), declarators, ",");
+        for (std::size_t i = 0; i < declarators.size(); i++)
+        {
+            std::string declarator = boost::trim_copy(declarators[i]);
+            declarator = declarator.substr(0, declarator.find('['));
+            boost::trim(declarator);
+            std::string::size_type const begin = declarator.find_last_of(" \t*&");
+            if (i == 0 && begin == std::string::npos)
+            {
+                // Type without name
+                return false;
+            }
+            std::string const name = begin == std::string::npos
+                ? declarator : declarator.substr(begin + 1);
+            if (! is_name(name))
+            {
+                return false;
+            }
+            names.push_back(name);
+        }
+        return ! names.empty();
+    }
+
+    // Replaces function-like macros which are identical to an inlined
+    // function (e.g. a macro and a static function calculating the same)
+    // by calls of that function
+    void remove_duplicate_macros()
+    {
+        std::map<std::string, std::string> const functions = inlined_function_bodies();
+        std::vector<macro_or_const> kept;
+        BOOST_FOREACH(macro_or_const const& macro, m_prop.defined_macros)
+        {
+            std::string::size_type const open = macro.name.find('(');
+            if (open == std::string::npos)
+            {
+                kept.push_back(macro);
+                continue;
+            }
+
+            std::string args = macro.name.substr(open + 1);
+            boost::replace_last(args, ")", "");
+            std::vector<std::string> arguments;
+            split(args, arguments, ", ");
+
+            std::map<std::string, std::string>::const_iterator it
+                = functions.find(normalized_body(macro.value, arguments));
+            if (it == functions.end())
+            {
+                kept.push_back(macro);
+                continue;
+            }
+
+            std::string const name = macro.name.substr(0, open);
+            BOOST_FOREACH(std::vector<std::string>* body, all_bodies())
+            {
+                BOOST_FOREACH(std::string& line, *body)
+                {
+                    rename_calls(line, name, it->second);
+                }
+            }
+            BOOST_FOREACH(macro_or_const& other, m_prop.defined_macros)
+            {
+                rename_calls(other.value, name, it->second);
+            }
+            m_prop.report["macros replaced by identical functions"]++;
+        }
+        m_prop.defined_macros = kept;
+    }
+
+    // Returns the inlined functions consisting of one return statement,
+    // as their normalized body (with their arity) and their name
+    std::map<std::string, std::string> inlined_function_bodies() const
+    {
+        std::map<std::string, std::string> result;
+        std::string const code = boost::join(blank_comments(m_prop.inlined_functions), " ");
+        std::string::size_type loc = find_name(code, "return", 0);
+        for (; loc != std::string::npos; loc = find_name(code, "return", loc + 1))
+        {
+            std::string::size_type const brace = code.find_last_not_of(" \t", loc == 0 ? 0 : loc - 1);
+            std::string::size_type const semicolon = code.find(';', loc);
+            if (loc == 0 || brace == std::string::npos || code[brace] != '{'
+                || semicolon == std::string::npos)
+            {
+                continue;
+            }
+            std::string::size_type const end = code.find_first_not_of(" \t", semicolon + 1);
+            if (end == std::string::npos || code[end] != '}')
+            {
+                continue;
+            }
+
+            // The header, e.g. "static double fS(double S, double C)"
+            std::string::size_type const previous = code.find_last_of(";}", brace);
+            std::string const header = boost::trim_copy(previous == std::string::npos
+                ? code.substr(0, brace)
+                : code.substr(previous + 1, brace - previous - 1));
+            std::string::size_type const open = header.find('(');
+            std::string::size_type const close = header.rfind(')');
+            if (open == std::string::npos || close == std::string::npos || close < open)
+            {
+                continue;
+            }
+            std::string::size_type const name_begin
+                = header.find_last_of(" \t*&", open == 0 ? 0 : open - 1);
+            std::string const name = boost::trim_copy(name_begin == std::string::npos
+                ? header.substr(0, open)
+                : header.substr(name_begin + 1, open - name_begin - 1));
+
+            std::vector<std::string> parameters, arguments;
+            split(header.substr(open + 1, close - open - 1), parameters, ",");
+            BOOST_FOREACH(std::string const& parameter, parameters)
+            {
+                std::vector<std::string> words;
+                split(parameter, words, " \t*&");
+                if (! words.empty())
+                {
+                    arguments.push_back(words.back());
+                }
+            }
+            if (is_name(name))
+            {
+                result[normalized_body(code.substr(loc + 6, semicolon - loc - 6), arguments)] = name;
+            }
+        }
+        return result;
+    }
+
+    // Returns the expression with its arguments numbered, without spaces
+    // and enclosing parentheses, followed by its arity
+    static std::string normalized_body(std::string expression,
+                std::vector<std::string> const& arguments)
+    {
+        for (std::size_t i = 0; i < arguments.size(); i++)
+        {
+            std::ostringstream out;
+            out << "@" << (i + 1);
+            std::string::size_type loc = find_name(expression, arguments[i], 0);
+            while (loc != std::string::npos)
+            {
+                expression.replace(loc, arguments[i].size(), out.str());
+                loc = find_name(expression, arguments[i], loc + out.str().size());
+            }
+        }
+        boost::erase_all(expression, " ");
+        boost::erase_all(expression, "\t");
+        while (expression.size() >= 2 && expression[0] == '('
+            && closing(expression, 0) == expression.size() - 1)
+        {
+            expression = expression.substr(1, expression.size() - 2);
+        }
+        std::ostringstream out;
+        out << expression << "/" << arguments.size();
+        return out.str();
+    }
+
+    // Renames the calls of function from into calls of function to
+    static void rename_calls(std::string& line, std::string const& from, std::string const& to)
+    {
+        std::string::size_type loc = find_name(line, from, 0);
+        while (loc != std::string::npos)
+        {
+            std::string::size_type const next = line.find_first_not_of(" \t", loc + from.size());
+            if (next != std::string::npos && line[next] == '(')
+            {
+                line.replace(loc, from.size(), to);
+            }
+            loc = find_name(line, from, loc + 1);
+        }
+    }
+
+    std::vector<std::vector<std::string>*> all_bodies()
+    {
+        std::vector<std::vector<std::string>*> result;
+        result.push_back(&m_prop.inlined_functions);
+        result.push_back(&m_prop.setup_functions);
+        BOOST_FOREACH(derived& der, m_prop.derived_projections)
+        {
+            result.push_back(&der.constructor_lines);
+        }
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            result.push_back(&proj.lines);
+        }
+        return result;
+    }
+
+    void determine_const_types()
+    {
+        BOOST_FOREACH(macro_or_const& con, m_prop.defined_consts)
+        {
+            // By default:
+            con.type = "double";
+
+            // Check if integer:
+            {
+                int value = atoi(con.value.c_str());
+                std::ostringstream out;
+                out << value;
+                if (out.str() == con.value)
+                {
+                    con.type = "int";
+                }
+            }
+
+            // Check if string
+            if (boost::starts_with(con.value, "\"")
+                && boost::ends_with(con.value, "\""))
+            {
+                con.type = "char const*";
+            }
+        }
+
+        determine_macro_types();
+    }
+
+    // Function-like macros are written as inline functions, they need a
+    // return type. It is derived from the operators and operands of the
+    // body, and, if it depends on the types of the arguments, from the usage
+    void determine_macro_types()
+    {
+        BOOST_FOREACH(macro_or_const& macro, m_prop.defined_macros)
+        {
+            std::string::size_type const open = macro.name.find('(');
+            if (open == std::string::npos)
+            {
+                continue;
+            }
+
+            std::string args = macro.name.substr(open + 1);
+            boost::replace_last(args, ")", "");
+            std::vector<std::string> list;
+            split(args, list, ", ");
+            std::set<std::string> const arguments(list.begin(), list.end());
+
+            macro.type = expression_type(macro.value, arguments);
+            if (macro.type.empty())
+            {
+                macro.type = used_as_index(macro.name.substr(0, open)) ? "int" : "double";
+            }
+        }
+    }
+
+    // Returns the type of a C expression: bool, int or double, or empty if
+    // it depends on the (template) types of the arguments
+    std::string expression_type(std::string const& expression,
+                std::set<std::string> const& arguments) const
+    {
+        std::string e = boost::trim_copy(expression);
+        while (e.size() >= 2 && e[0] == '(' && closing(e, 0) == e.size() - 1)
+        {
+            e = boost::trim_copy(e.substr(1, e.size() - 2));
+        }
+        if (e.empty())
+        {
+            return "";
+        }
+
+        std::vector<std::string::size_type> positions, lengths;
+        int const level = top_level_operators(e, positions, lengths);
+        if (level == 1)
+        {
+            // Conditional expression: the type of its alternatives
+            std::string::size_type const colon = matching_colon(e, positions[0]);
+            if (colon == std::string::npos)
+            {
+                return "";
+            }
+            return arithmetic_type(
+                expression_type(e.substr(positions[0] + 1, colon - positions[0] - 1), arguments),
+                expression_type(e.substr(colon + 1), arguments));
+        }
+        if (level == 2 || level == 3 || level == 7 || level == 8)
+        {
+            // Logical operators and comparisons
+            return "bool";
+        }
+        if (level == 4 || level == 5 || level == 6 || level == 9)
+        {
+            // Bitwise operators and shifts
+            return "int";
+        }
+        if (level == 10 || level == 11)
+        {
+            std::string result = "int";
+            std::string::size_type begin = 0;
+            for (std::size_t i = 0; i <= positions.size(); i++)
+            {
+                std::string::size_type const end = i < positions.size() ? positions[i] : e.size();
+                if (i < positions.size() && e[positions[i]] == '%')
+                {
+                    return "int";
+                }
+                result = arithmetic_type(result,
+                    expression_type(e.substr(begin, end - begin), arguments));
+                if (i < positions.size())
+                {
+                    begin = end + lengths[i];
+                }
+            }
+            return result;
+        }
+
+        // Unary operators, casts, literals, names and calls
+        if (e[0] == '!')
+        {
+            return "bool";
+        }
+        if (e[0] == '~')
+        {
+            return "int";
+        }
+        if (e[0] == '-' || e[0] == '+')
+        {
+            return expression_type(e.substr(1), arguments);
+        }
+        if (e[0] == '(')
+        {
+            std::string::size_type const close = closing(e, 0);
+            if (close == std::string::npos)
+            {
+                return "";
+            }
+            std::string const cast = boost::trim_copy(e.substr(1, close - 1));
+            return cast == "double" || cast == "float" ? "double"
+                : cast == "int" || cast == "long" || cast == "unsigned" || cast == "short" ? "int"
+                : "";
+        }
+        if (std::isdigit(e[0]) || e[0] == '.')
+        {
+            return e.find_first_of(".eE") == std::string::npos
+                || boost::starts_with(e, "0x") || boost::starts_with(e, "0X")
+                ? "int" : "double";
+        }
+
+        std::string::size_type const end = e.find_first_not_of(
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+        std::string const name = e.substr(0, end);
+        if (end == std::string::npos && arguments.count(name) > 0)
+        {
+            return "";
+        }
+        if (end == std::string::npos)
+        {
+            BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+            {
+                if (con.name == name && con.type == "int")
+                {
+                    return "int";
+                }
+            }
+        }
+        else if (e[end] == '(')
+        {
+            // Call of another (already typed) function-like macro
+            BOOST_FOREACH(macro_or_const const& macro, m_prop.defined_macros)
+            {
+                if (boost::starts_with(macro.name, name + "(") && ! macro.type.empty())
+                {
+                    return macro.type;
+                }
+            }
+        }
+        return "double";
+    }
+
+    // Returns the arithmetic type of two operands, empty if either is unknown
+    static std::string arithmetic_type(std::string const& a, std::string const& b)
+    {
+        if (a.empty() || b.empty())
+        {
+            return "";
+        }
+        if (a == "bool" && b == "bool")
+        {
+            return "bool";
+        }
+        return a == "double" || b == "double" ? "double" : "int";
+    }
+
+    // Returns the precedence level (1: conditional, ... 11: multiplicative)
+    // of the lowest binary operators on the top level of the expression,
+    // with their positions, or 0 if there are none
+    static int top_level_operators(std::string const& e,
+                std::vector<std::string::size_type>& positions,
+                std::vector<std::string::size_type>& lengths)
+    {
+        int lowest = 0;
+        int depth = 0;
+        bool operand = false;
+        std::string::size_type i = 0;
+        while (i < e.size())
+        {
+            char const ch = e[i];
+            char const next = i + 1 < e.size() ? e[i + 1] : ' ';
+            if (std::isalnum(ch) || ch == '_' || (ch == '.' && std::isdigit(next)))
+            {
+                // Names, or numbers including their exponent
+                bool const number = std::isdigit(ch) || ch == '.';
+                while (i < e.size() && (std::isalnum(e[i]) || e[i] == '_' || e[i] == '.'
+                    || (number && (e[i] == '-' || e[i] == '+')
+                        && (e[i - 1] == 'e' || e[i - 1] == 'E'))))
+                {
+                    i++;
+                }
+                operand = true;
+                continue;
+            }
+
+            std::string::size_type length = 1;
+            int level = 0;
+            if (ch == '(' || ch == '[')
+            {
+                depth++;
+                operand = false;
+            }
+            else if (ch == ')' || ch == ']')
+            {
+                depth--;
+                operand = true;
+            }
+            else if (ch == '-' && next == '>')
+            {
+                length = 2;
+                operand = false;
+            }
+            else if (ch == '.')
+            {
+                operand = false;
+            }
+            else if (! std::isspace(ch))
+            {
+                std::string const two = e.substr(i, 2);
+                if (two == "||") { level = 2; length = 2; }
+                else if (two == "&&") { level = 3; length = 2; }
+                else if (two == "==" || two == "!=") { level = 7; length = 2; }
+                else if (two == "<=" || two == ">=") { level = 8; length = 2; }
+                else if (two == "<<" || two == ">>") { level = 9; length = 2; }
+                else if (ch == '?') { level = 1; }
+                else if (ch == '|') { level = 4; }
+                else if (ch == '^') { level = 5; }
+                else if (ch == '&') { level = 6; }
+                else if (ch == '<' || ch == '>') { level = 8; }
+                else if (ch == '+' || ch == '-') { level = 10; }
+                else if (ch == '*' || ch == '/' || ch == '%') { level = 11; }
+
+                // Unary operators follow another operator, or nothing
+                if (! operand || ch == ':')
+                {
+                    level = 0;
+                }
+                operand = false;
+            }
+
+            if (level > 0 && depth == 0)
+            {
+                if (lowest == 0 || level < lowest)
+                {
+                    lowest = level;
+                    positions.clear();
+                    lengths.clear();
+                }
+                if (level == lowest)
+                {
+                    positions.push_back(i);
+                    lengths.push_back(length);
+                }
+            }
+            i += length;
+        }
+        return lowest;
+    }
+
+    // Returns the position of the colon belonging to the question mark
+    static std::string::size_type matching_colon(std::string const& e, std::string::size_type question)
+    {
+        int depth = 0, nested = 0;
+        for (std::string::size_type i = question + 1; i < e.size(); i++)
+        {
+            char const ch = e[i];
+            depth += ch == '(' || ch == '[' ? 1 : ch == ')' || ch == ']' ? -1 : 0;
+            if (depth == 0 && ch == '?')
+            {
+                nested++;
+            }
+            else if (depth == 0 && ch == ':' && nested-- == 0)
+            {
+                return i;
+            }
+        }
+        return std::string::npos;
+    }
+
+    // Returns true if a call of the function-like macro is used as an array index
+    bool used_as_index(std::string const& name)
+    {
+        BOOST_FOREACH(std::vector<std::string>* body, all_bodies())
+        {
+            BOOST_FOREACH(std::string const& line, *body)
+            {
+                std::string::size_type loc = find_name(line, name, 0);
+                for (; loc != std::string::npos; loc = find_name(line, name, loc + 1))
+                {
+                    // The innermost open bracket before the call
+                    std::string open;
+                    for (std::string::size_type i = 0; i < loc; i++)
+                    {
+                        if (line[i] == '(' || line[i] == '[')
+                        {
+                            open += line[i];
+                        }
+                        else if ((line[i] == ')' || line[i] == ']') && ! open.empty())
+                        {
+                            open.erase(open.size() - 1);
+                        }
+                    }
+                    if (! open.empty() && open[open.size() - 1] == '[')
+                    {
+                        return true;
+                    }
                 }
             }
         }
+        return false;
     }
 
 
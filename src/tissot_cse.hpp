@@ -0,0 +1,870 @@
+#ifndef TISSOT_CSE_HPP
+#define TISSOT_CSE_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Hoists repeated calls of pure (math) functions, and repeated arithmetic
+// subexpressions (e.g. this->m_par.e * sinphi, or 1. - es * sinphi * sinphi),
+// in a forward or inverse body into double const locals. This is done
+// conservatively:
+// - all names used in the expression are not assigned from the declaration
+//   up to the last replaced occurrence (including the nested blocks, which
+//   might be loops, that occurrence is in), so the value cannot vary
+// - the expression is always evaluated where the local is declared, so no
+//   path evaluates more than before
+// - only occurrences in the scope of the declaration are replaced
+// - subexpressions are only taken from statements on one line, as a prefix
+//   of a sum or product (which is how C associates), having at least one
+//   double operand (such that the local has the same type)
+class cse_hoister
+{
+public :
+    cse_hoister(std::vector<std::string>& lines, std::map<std::string, int>& report,
+                std::set<std::string> const& double_members)
+        : m_lines(lines)
+        , m_report(report)
+        , m_pure(pure_functions())
+        , m_double_members(double_members)
+    {
+
+        char const* par[] = { "a", "ra", "e", "es", "one_es", "rone_es",
+            "lam0", "phi0", "x0", "y0", "k0", "to_meter", "fr_meter" };
+        m_double_members.insert(par, par + sizeof(par) / sizeof(par[0]));
+    }
+
+    // Returns the number of hoisted expressions
+    int apply()
+    {
+        int count = 0;
+        // Each hoist changes the lines, so restart scanning after each
+        while (hoist_one())
+        {
+            count++;
+        }
+        return count;
+    }
+
+private :
+
+    struct occurrence
+    {
+        std::size_t line;
+        std::string::size_type pos, length;
+    };
+
+    void analyze()
+    {
+        m_code = blank_comments(m_lines);
+        m_blocks.clear();
+        m_switch_blocks.clear();
+        m_double_locals.clear();
+        m_double_locals.insert("lp_lon");
+        m_double_locals.insert("lp_lat");
+        m_double_locals.insert("xy_x");
+        m_double_locals.insert("xy_y");
+
+        std::vector<int> path(1, 0);
+        int next_block = 1;
+        bool previous_was_switch = false;
+        for (std::size_t i = 0; i < m_lines.size(); i++)
+        {
+            std::string const& code = m_code[i];
+            m_blocks.push_back(path);
+
+            bool const is_switch = boost::starts_with(boost::trim_copy(code), "switch");
+            for (std::string::size_type j = 0; j < code.size(); j++)
+            {
+                if (code[j] == '{')
+                {
+                    if (is_switch || previous_was_switch)
+                    {
+                        m_switch_blocks.insert(next_block);
+                    }
+                    path.push_back(next_block++);
+                }
+                else if (code[j] == '}' && path.size() > 1)
+                {
+                    path.pop_back();
+                }
+            }
+            if (! boost::trim_copy(code).empty())
+            {
+                previous_was_switch = is_switch && code.find('{') == std::string::npos;
+            }
+
+            collect_assignments(code, i);
+            collect_double_locals(code);
+        }
+    }
+
+    // Collects the names declared as double (e.g. double t = 1, s;)
+    void collect_double_locals(std::string const& code)
+    {
+        std::string const trimmed = boost::trim_copy(code);
+        if (! boost::starts_with(trimmed, "double "))
+        {
+            return;
+        }
+        int depth = 0;
+        bool expect_name = true;
+        for (std::string::size_type j = 7; j < trimmed.size(); j++)
+        {
+            char const c = trimmed[j];
+            if (c == '(' || c == '[')
+            {
+                depth++;
+            }
+            else if (c == ')' || c == ']')
+            {
+                depth--;
+            }
+            else if (c == ',' && depth == 0)
+            {
+                expect_name = true;
+            }
+            else if (expect_name && is_name_char(c))
+            {
+                std::string const name = name_at(trimmed, j);
+                if (name != "const")
+                {
+                    m_double_locals.insert(name);
+                    expect_name = false;
+                }
+                j += name.size() - 1;
+            }
+        }
+    }
+
+    // Collects the (root) names of all variables which are assigned, incremented,
+    // of which the address is taken, or which are passed to functions which
+    // are not known to be pure (and might be taken by reference)
+    void collect_assignments(std::string const& code, std::size_t line)
+    {
+        for (std::string::size_type j = 0; j < code.size(); j++)
+        {
+            char const c = code[j];
+            bool const next_is_eq = j + 1 < code.size() && code[j + 1] == '=';
+            if (c == '=' && ! next_is_eq
+                && (j == 0 || std::string("=!<>").find(code[j - 1]) == std::string::npos))
+            {
+                std::string::size_type end = j;
+                if (j > 0 && std::string("+-*/%&|^").find(code[j - 1]) != std::string::npos)
+                {
+                    end = j - 1;
+                }
+                m_assigned[lvalue_root(code, end)].push_back(line);
+            }
+            else if ((c == '+' || c == '-') && j + 1 < code.size() && code[j + 1] == c)
+            {
+                m_assigned[lvalue_root(code, j)].push_back(line);
+                m_assigned[name_at(code, j + 2)].push_back(line);
+                j++;
+            }
+            else if (c == '&' && j + 1 < code.size() && code[j + 1] != '&'
+                && (j == 0 || code[j - 1] != '&'))
+            {
+                m_assigned[name_at(code, j + 1)].push_back(line);
+            }
+            else if (c == '(' && j > 0)
+            {
+                std::string const function = function_before(code, j);
+                if (! function.empty() && m_pure.count(function) == 0
+                    && ! is_keyword(function))
+                {
+                    std::string::size_type const end = closing(code, j);
+                    std::vector<std::string> const names = names_in(
+                        code.substr(j + 1, end == std::string::npos ? std::string::npos : end - j - 1));
+                    for (std::size_t k = 0; k < names.size(); k++)
+                    {
+                        m_assigned[names[k]].push_back(line);
+                    }
+                }
+            }
+        }
+    }
+
+    static bool is_keyword(std::string const& name)
+    {
+        return name == "if" || name == "for" || name == "while" || name == "switch"
+            || name == "return" || name == "sizeof";
+    }
+
+    // Returns true if the call only consists of pure functions, operators,
+    // numbers and names
+    bool is_pure(std::string const& call) const
+    {
+        if (call.find_first_of("=[&|?") != std::string::npos
+            || call.find("++") != std::string::npos
+            || call.find("--") != std::string::npos
+            || call.find("<") != std::string::npos)
+        {
+            return false;
+        }
+        for (std::string::size_type j = 1; j < call.size(); j++)
+        {
+            if (call[j] == '(')
+            {
+                std::string const function = function_before(call, j);
+                if (! function.empty() && m_pure.count(function) == 0)
+                {
+                    return false;
+                }
+            }
+            // Dereferencing a pointer
+            if (call[j] == '*' && std::string("(,*+-/ ").find(call[j - 1]) != std::string::npos)
+            {
+                std::string::size_type k = j - 1;
+                while (k > 0 && call[k] == ' ')
+                {
+                    k--;
+                }
+                if (std::string("(,*+-/").find(call[k]) != std::string::npos)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns true if no name of the expression is (or might be) changed
+    // in the lines from start up to and including end
+    bool unchanged(std::string const& expression, std::size_t start, std::size_t end) const
+    {
+        std::vector<std::string> const names = names_in(expression);
+        for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+        {
+            std::map<std::string, std::vector<std::size_t> >::const_iterator
+                found = m_assigned.find(*it);
+            if (found == m_assigned.end())
+            {
+                continue;
+            }
+            for (std::size_t k = 0; k < found->second.size(); k++)
+            {
+                if (found->second[k] >= start && found->second[k] <= end)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns true if the expression has a double operand: a floating point
+    // number, a pure call, or a name or member declared as double. Other
+    // operands are converted to it, so the expression is double too
+    bool has_double_operand(std::string const& expression) const
+    {
+        std::string::size_type j = 0;
+        while (j < expression.size())
+        {
+            char const c = expression[j];
+            if (std::isdigit(c) || (c == '.' && j + 1 < expression.size() && std::isdigit(expression[j + 1])))
+            {
+                std::string::size_type k = j;
+                bool floating = false;
+                while (k < expression.size() && (is_name_char(expression[k]) || expression[k] == '.'
+                    || ((expression[k] == '-' || expression[k] == '+')
+                        && (expression[k - 1] == 'e' || expression[k - 1] == 'E'))))
+                {
+                    floating = floating || expression[k] == '.'
+                        || expression[k] == 'e' || expression[k] == 'E';
+                    k++;
+                }
+                if (floating)
+                {
+                    return true;
+                }
+                j = k;
+            }
+            else if (is_name_char(c))
+            {
+                std::string const name = name_at(expression, j);
+                std::string::size_type k = j + name.size();
+                if (name == "this")
+                {
+                    // this->m_par.e or this->m_proj_parm.n
+                    std::string::size_type const dot = expression.find('.', k);
+                    std::string const member = dot == std::string::npos
+                        ? "" : name_at(expression, dot + 1);
+                    if (m_double_members.count(member) > 0)
+                    {
+                        return true;
+                    }
+                    k = dot == std::string::npos ? expression.size() : dot + 1 + member.size();
+                }
+                else if (m_pure.count(name) > 0 || m_double_locals.count(name) > 0)
+                {
+                    return true;
+                }
+                j = k;
+            }
+            else
+            {
+                j++;
+            }
+        }
+        return false;
+    }
+
+    // Collects all calls of pure functions, keyed by their text without spaces
+    void collect(std::map<std::string, std::vector<occurrence> >& calls) const
+    {
+        for (std::size_t i = 0; i < m_code.size(); i++)
+        {
+            std::string const& code = m_code[i];
+            for (std::string::size_type j = 1; j < code.size(); j++)
+            {
+                if (code[j] != '(')
+                {
+                    continue;
+                }
+                std::string const function = function_before(code, j);
+                if (function.empty() || m_pure.count(function) == 0)
+                {
+                    continue;
+                }
+                std::string::size_type const begin = j - function.size();
+                if (begin > 0 && (code[begin - 1] == '.' || code[begin - 1] == '>'))
+                {
+                    continue;
+                }
+                std::string::size_type const end = closing(code, j);
+                if (end == std::string::npos)
+                {
+                    continue;
+                }
+                occurrence occ;
+                occ.line = i;
+                occ.pos = begin;
+                occ.length = end + 1 - begin;
+                calls[boost::erase_all_copy(code.substr(begin, occ.length), " ")].push_back(occ);
+            }
+        }
+    }
+
+    // Collects all prefixes of sums and products, in statements on one line,
+    // keyed by their text without spaces
+    void collect_expressions(std::map<std::string, std::vector<occurrence> >& expressions) const
+    {
+        for (std::size_t i = 0; i < m_code.size(); i++)
+        {
+            std::string const& code = m_code[i];
+            std::string const trimmed = boost::trim_copy(code);
+            std::size_t p = i;
+            std::string const previous = previous_code(m_code, p);
+            std::string next;
+            for (std::size_t n = i + 1; n < m_code.size() && next.empty(); n++)
+            {
+                next = boost::trim_copy(m_code[n]);
+            }
+            if (trimmed.empty() || trimmed[0] == '#'
+                || std::string(";{)").find(trimmed[trimmed.size() - 1]) == std::string::npos
+                || (! previous.empty() && previous[0] != '#'
+                    && std::string(";{}:").find(previous[previous.size() - 1]) == std::string::npos)
+                || (! next.empty() && std::string("*/%+-&|^?:<>=.").find(next[0]) != std::string::npos))
+            {
+                continue;
+            }
+
+            // The line itself, and the contents of every parenthesis
+            collect_segments(code, 0, code.size(), i, expressions);
+            for (std::string::size_type j = 0; j < code.size(); j++)
+            {
+                if (code[j] == '(')
+                {
+                    std::string::size_type const end = closing(code, j);
+                    if (end != std::string::npos)
+                    {
+                        collect_segments(code, j + 1, end, i, expressions);
+                    }
+                }
+            }
+        }
+    }
+
+    static bool is_operand_end(char c)
+    {
+        return is_name_char(c) || c == ')' || c == ']' || c == '.';
+    }
+
+    // Returns true if the sign at j is part of a number (1e-10)
+    static bool is_exponent_sign(std::string const& code, std::string::size_type j)
+    {
+        if (j < 2 || (code[j - 1] != 'e' && code[j - 1] != 'E'))
+        {
+            return false;
+        }
+        std::string::size_type k = j - 1;
+        while (k > 0 && (is_name_char(code[k - 1]) || code[k - 1] == '.'))
+        {
+            k--;
+        }
+        return std::isdigit(code[k]) || code[k] == '.';
+    }
+
+    // Splits [begin, end) on separators binding weaker than + and -
+    void collect_segments(std::string const& code,
+                std::string::size_type begin, std::string::size_type end,
+                std::size_t line,
+                std::map<std::string, std::vector<occurrence> >& expressions) const
+    {
+        int depth = 0;
+        std::string::size_type segment = begin;
+        for (std::string::size_type j = begin; j <= end; j++)
+        {
+            char const c = j < end ? code[j] : ';';
+            if (c == '(' || c == '[')
+            {
+                depth++;
+            }
+            else if (c == ')' || c == ']')
+            {
+                depth--;
+            }
+            else if (depth == 0
+                && ((c == '>' && j > 0 && code[j - 1] == '-')
+                    || (c == ':' && ((j > 0 && code[j - 1] == ':') || (j + 1 < end && code[j + 1] == ':')))))
+            {
+                // Member access, or a qualified name
+            }
+            else if (depth == 0 && std::string(",?:;=<>!&|^%~{}").find(c) != std::string::npos)
+            {
+                collect_sum(code, segment, j, line, expressions);
+                segment = j + 1;
+            }
+        }
+    }
+
+    // Adds the prefixes of the sum (with at least two terms) and of its
+    // products (with at least two factors)
+    void collect_sum(std::string const& code,
+                std::string::size_type begin, std::string::size_type end,
+                std::size_t line,
+                std::map<std::string, std::vector<occurrence> >& expressions) const
+    {
+        std::vector<std::string::size_type> term_begins, term_ends;
+        int depth = 0;
+        std::string::size_type term = begin;
+        bool operand = false;
+        for (std::string::size_type j = begin; j <= end; j++)
+        {
+            char const c = j < end ? code[j] : '+';
+            bool const arrow = c == '-' && j + 1 < end && code[j + 1] == '>';
+            if (c == '(' || c == '[')
+            {
+                depth++;
+            }
+            else if (c == ')' || c == ']')
+            {
+                depth--;
+            }
+            else if (depth == 0 && (c == '+' || c == '-') && ! arrow
+                && (operand || j == end) && ! is_exponent_sign(code, j))
+            {
+                term_begins.push_back(term);
+                term_ends.push_back(j);
+                term = j + 1;
+            }
+            if (c != ' ')
+            {
+                operand = is_operand_end(c) && ! (c == '-' || c == '+');
+            }
+        }
+
+        for (std::size_t t = 0; t < term_begins.size(); t++)
+        {
+            if (boost::trim_copy(code.substr(term_begins[t], term_ends[t] - term_begins[t])).empty())
+            {
+                // E.g. the left side of -=
+                return;
+            }
+        }
+        for (std::size_t t = 0; t < term_begins.size(); t++)
+        {
+            collect_product(code, term_begins[t], term_ends[t], line, expressions);
+            if (t > 0)
+            {
+                add_expression(code, begin, term_ends[t], line, expressions);
+            }
+        }
+    }
+
+    void collect_product(std::string const& code,
+                std::string::size_type begin, std::string::size_type end,
+                std::size_t line,
+                std::map<std::string, std::vector<occurrence> >& expressions) const
+    {
+        // Skip a unary sign, -a * b is evaluated as (-a) * b, which is -(a * b)
+        while (begin < end && (code[begin] == ' ' || code[begin] == '-' || code[begin] == '+'))
+        {
+            begin++;
+        }
+        int depth = 0;
+        int factors = 0;
+        std::string::size_type factor = begin;
+        for (std::string::size_type j = begin; j <= end; j++)
+        {
+            char const c = j < end ? code[j] : '*';
+            if (c == '(' || c == '[')
+            {
+                depth++;
+            }
+            else if (c == ')' || c == ']')
+            {
+                depth--;
+            }
+            else if (depth == 0 && (c == '*' || c == '/'))
+            {
+                if (boost::trim_copy(code.substr(factor, j - factor)).empty())
+                {
+                    // E.g. the left side of *=, or a dereference
+                    return;
+                }
+                factor = j + 1;
+                if (++factors > 1)
+                {
+                    add_expression(code, begin, j, line, expressions);
+                }
+            }
+        }
+    }
+
+    void add_expression(std::string const& code,
+                std::string::size_type begin, std::string::size_type end,
+                std::size_t line,
+                std::map<std::string, std::vector<occurrence> >& expressions) const
+    {
+        while (begin < end && code[begin] == ' ')
+        {
+            begin++;
+        }
+        while (end > begin && code[end - 1] == ' ')
+        {
+            end--;
+        }
+        std::string const expression = code.substr(begin, end - begin);
+        if (expression.find_first_of("*/") == std::string::npos
+            || ! has_double_operand(expression))
+        {
+            return;
+        }
+        occurrence occ;
+        occ.line = line;
+        occ.pos = begin;
+        occ.length = end - begin;
+        expressions[boost::erase_all_copy(expression, " ")].push_back(occ);
+    }
+
+    static bool occurs_before(occurrence const& a, occurrence const& b)
+    {
+        return a.line < b.line || (a.line == b.line && a.pos < b.pos);
+    }
+
+    static std::string previous_code(std::vector<std::string> const& code, std::size_t& i)
+    {
+        while (i > 0)
+        {
+            i--;
+            std::string const trimmed = boost::trim_copy(code[i]);
+            if (! trimmed.empty())
+            {
+                return trimmed;
+            }
+        }
+        return "";
+    }
+
+    // Returns the line where the statement containing the occurrence starts,
+    // or npos if the occurrence is not evaluated unconditionally there
+    std::size_t statement_start(occurrence const& occ) const
+    {
+        std::size_t start = occ.line;
+        std::size_t i = occ.line;
+        std::string previous = previous_code(m_code, i);
+        while (! previous.empty()
+            && std::string(";{}:").find(previous[previous.size() - 1]) == std::string::npos
+            && previous[0] != '#'
+            && m_blocks[i] == m_blocks[occ.line])
+        {
+            start = i;
+            previous = previous_code(m_code, i);
+        }
+
+        // The statement should start in the same block
+        if (m_blocks[start] != m_blocks[occ.line])
+        {
+            return std::string::npos;
+        }
+
+        std::string const statement = boost::trim_copy(m_code[start]);
+        char const* conditional[] = { "}", "else", "case ", "default", "for",
+            "while", "do", "switch" };
+        for (std::size_t k = 0; k < sizeof(conditional) / sizeof(conditional[0]); k++)
+        {
+            if (boost::starts_with(statement, conditional[k])
+                && (statement.size() == std::strlen(conditional[k])
+                    || ! is_name_char(statement[std::strlen(conditional[k])])))
+            {
+                return std::string::npos;
+            }
+        }
+
+        // The text before the occurrence should not make it conditional
+        std::string before;
+        for (std::size_t k = start; k < occ.line; k++)
+        {
+            before += m_code[k] + " ";
+        }
+        before += m_code[occ.line].substr(0, occ.pos);
+        if (boost::contains(before, "?") || boost::contains(before, "&&")
+            || boost::contains(before, "||"))
+        {
+            return std::string::npos;
+        }
+        if (boost::starts_with(statement, "if"))
+        {
+            // Only the condition of a (single line) if statement is unconditional
+            std::string::size_type const open = m_code[start].find('(');
+            std::string::size_type const end = closing(m_code[start], open);
+            if (start != occ.line || end == std::string::npos || occ.pos > end)
+            {
+                return std::string::npos;
+            }
+        }
+        return start;
+    }
+
+    static bool in_scope(std::vector<int> const& inner, std::vector<int> const& outer)
+    {
+        return inner.size() >= outer.size()
+            && std::equal(outer.begin(), outer.end(), inner.begin());
+    }
+
+    std::string local_name(std::string const& call) const
+    {
+        std::string::size_type const open = call.find('(');
+        if (open == std::string::npos || ! is_name(function_before(call, open))
+            || closing(call, open) + 1 != call.size())
+        {
+            return expression_name(call);
+        }
+        std::string function = call.substr(0, open);
+        std::string::size_type const colon = function.rfind(':');
+        if (colon != std::string::npos)
+        {
+            function.erase(0, colon + 1);
+        }
+
+        // Use the name of a single argument, e.g. sin_lp_lat, or a number
+        std::string argument = call.substr(open + 1, call.size() - open - 2);
+        boost::replace_all(argument, "->", ".");
+        std::string::size_type const dot = argument.rfind('.');
+        if (dot != std::string::npos && ! std::isdigit(argument[0]))
+        {
+            argument.erase(0, dot + 1);
+        }
+
+        std::string base = is_name(argument) ? function + "_" + argument : function;
+        std::string name = is_name(argument) ? base : base + "_1";
+        for (int n = 2; used(name); n++)
+        {
+            name = base + "_" + boost::lexical_cast<std::string>(n);
+        }
+        return name;
+    }
+
+    // Returns the name for an expression, its (last) operand names joined,
+    // e.g. e_sinphi for this->m_par.e * sinphi, or es_sinphi for
+    // 1. - this->m_par.es * sinphi * sinphi
+    std::string expression_name(std::string const& expression) const
+    {
+        std::string base;
+        int count = 0;
+        for (std::string::size_type j = 0; j < expression.size() && count < 3; )
+        {
+            if (! is_name_char(expression[j]) || std::isdigit(expression[j])
+                || (j > 0 && is_name_char(expression[j - 1])))
+            {
+                j++;
+                continue;
+            }
+            std::string const name = name_at(expression, j);
+            j += name.size();
+            bool const followed = j < expression.size()
+                && (expression[j] == '(' || expression[j] == '.'
+                    || expression.compare(j, 2, "->") == 0);
+            if (! followed && name != "this" && ! contains_name(base, name))
+            {
+                base += (base.empty() ? "" : "_") + name;
+                count++;
+            }
+        }
+        if (base.empty())
+        {
+            base = "expr";
+        }
+        std::string name = base;
+        for (int n = 2; used(name); n++)
+        {
+            name = base + "_" + boost::lexical_cast<std::string>(n);
+        }
+        return name;
+    }
+
+    bool used(std::string const& name) const
+    {
+        for (std::size_t i = 0; i < m_lines.size(); i++)
+        {
+            if (contains_name(m_lines[i], name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hoist_one()
+    {
+        m_assigned.clear();
+        analyze();
+
+        std::map<std::string, std::vector<occurrence> > calls;
+        collect(calls);
+        collect_expressions(calls);
+
+        // Start with the longest expressions, they might contain shorter ones
+        std::multimap<std::size_t, std::string, std::greater<std::size_t> > by_length;
+        for (std::map<std::string, std::vector<occurrence> >::const_iterator it = calls.begin();
+            it != calls.end(); ++it)
+        {
+            if (it->second.size() > 1)
+            {
+                by_length.insert(std::make_pair(it->first.size(), it->first));
+            }
+        }
+
+        for (std::multimap<std::size_t, std::string, std::greater<std::size_t> >::const_iterator
+            it = by_length.begin(); it != by_length.end(); ++it)
+        {
+            std::vector<occurrence>& occurrences = calls[it->second];
+            std::sort(occurrences.begin(), occurrences.end(), occurs_before);
+            if (hoist(occurrences))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Hoists, starting at the first occurrence which is executed unconditionally
+    bool hoist(std::vector<occurrence> const& occurrences)
+    {
+        for (std::size_t f = 0; f + 1 < occurrences.size(); f++)
+        {
+            occurrence const& first = occurrences[f];
+            std::string const call = m_code[first.line].substr(first.pos, first.length);
+            std::size_t const start = statement_start(first);
+            if (start == std::string::npos || ! is_pure(call))
+            {
+                continue;
+            }
+            std::vector<int> const& block = m_blocks[first.line];
+            if (m_switch_blocks.count(block.back()) > 0)
+            {
+                // A declaration in a switch might be jumped over
+                continue;
+            }
+
+            std::vector<occurrence> replaced;
+            for (std::size_t k = f; k < occurrences.size(); k++)
+            {
+                if (in_scope(m_blocks[occurrences[k].line], block))
+                {
+                    replaced.push_back(occurrences[k]);
+                }
+            }
+            if (replaced.size() < 2)
+            {
+                continue;
+            }
+
+            // The value should not change up to the last occurrence,
+            // including the rest of the nested blocks (loops) it is in
+            std::size_t end = replaced.back().line;
+            while (end + 1 < m_blocks.size()
+                && m_blocks[end + 1].size() > block.size()
+                && in_scope(m_blocks[end + 1], block))
+            {
+                end++;
+            }
+            if (! unchanged(call, start, end))
+            {
+                continue;
+            }
+
+            std::string const name = local_name(call);
+
+            // Replace from the back, such that positions stay valid
+            for (std::size_t k = replaced.size(); k > 0; k--)
+            {
+                occurrence const& occ = replaced[k - 1];
+                m_lines[occ.line].replace(occ.pos, occ.length, name);
+            }
+            std::string const& line = m_lines[start];
+            std::string const indent = line.substr(0, line.find_first_not_of(" \t"));
+            m_lines.insert(m_lines.begin() + start,
+                indent + "double const " + name + " = " + call + ";");
+
+            m_report["cse " + call] += static_cast<int>(replaced.size());
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<std::string>& m_lines;
+    std::map<std::string, int>& m_report;
+
+    std::set<std::string> m_pure;
+    std::set<std::string> m_double_members;
+    std::set<std::string> m_double_locals;
+    // Lines where names are (or might be) changed
+    std::map<std::string, std::vector<std::size_t> > m_assigned;
+
+    std::vector<std::string> m_code;
+    std::vector<std::vector<int> > m_blocks;
+    std::set<int> m_switch_blocks;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_CSE_HPP
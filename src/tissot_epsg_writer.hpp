@@ -0,0 +1,293 @@
+#ifndef TISSOT_EPSG_WRITER_HPP
+#define TISSOT_EPSG_WRITER_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/foreach.hpp>
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Writes a program creating each EPSG definition of the group through the
+// generated factory registration, and doing forward/inverse round trips on
+// a grid around its center. Reports CSV with errors and throughput per code
+class proj4_epsg_writer
+{
+    public :
+        proj4_epsg_writer(projection_properties& projpar
+                , std::string const& group
+                , std::vector<epsg_entry> const& epsg_entries
+                , std::ostream& str)
+            : m_prop(projpar)
+            , stream(str)
+            , projection_group(group)
+            , m_epsg_entries(epsg_entries)
+        {
+        }
+
+        void write()
+        {
+            write_header();
+            write_cases();
+            write_functions();
+
+            stream
+                << "int main(int argc, char** argv)" << std::endl
+                << "{" << std::endl
+                << tab1 << "if (argc < 2 || std::string(argv[1]) != \"--no-header\")" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cout << \"epsg,projection,status,points,failed,max_error_m,ns_per_roundtrip\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << tab1 << "group_factory factory;" << std::endl
+                << tab1 << "bgp::detail::" << projection_group << "_init(factory);" << std::endl
+                << std::endl
+                << tab1 << "for (std::size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "round_trip(factory, cases[i]);" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "return 0;" << std::endl
+                << "}" << std::endl;
+        }
+
+    private :
+
+        void write_header()
+        {
+            stream
+                << "// Round trips of the EPSG definitions of " << projection_group
+                << ", with errors in metres and nanoseconds per round trip" << std::endl
+                << "// Generated by tissot, compile it with optimization against the generated projection" << std::endl
+                << std::endl
+                << "#include <cmath>" << std::endl
+                << "#include <ctime>" << std::endl
+                << "#include <iostream>" << std::endl
+                << "#include <map>" << std::endl
+                << "#include <string>" << std::endl
+                << "#include <vector>" << std::endl
+                << std::endl
+                << "#include <boost/shared_ptr.hpp>" << std::endl
+                << "#include <boost/geometry.hpp>" << std::endl
+                << include_projections << "/parameters.hpp>" << std::endl;
+            if (! m_prop.link_type.empty())
+            {
+                // The default link is created by the factory
+                stream << include_projections << "/factory.hpp>" << std::endl;
+            }
+            stream
+                << include_projections << "/proj/" << projection_group << ".hpp>" << std::endl
+                << std::endl
+                << "namespace bg = boost::geometry;" << std::endl
+                << "namespace bgp = boost::geometry::projections;" << std::endl
+                << std::endl
+                << "typedef bg::model::point<double, 2, bg::cs::cartesian> point_type;" << std::endl
+                << "typedef bgp::projection<point_type, point_type> projection_type;" << std::endl
+                << "typedef bgp::detail::factory_entry<point_type, point_type, bgp::parameters> entry_type;" << std::endl
+                << std::endl
+                << "// Factory with the projections of this group only" << std::endl
+                << "class group_factory : public bgp::detail::base_factory<point_type, point_type, bgp::parameters>" << std::endl
+                << "{" << std::endl
+                << "public :" << std::endl
+                << tab1 << "virtual void add_to_factory(std::string const& name, entry_type* sub)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "m_entries[name].reset(sub);" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << tab1 << "projection_type* create_new(bgp::parameters const& par) const" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::map<std::string, boost::shared_ptr<entry_type> >::const_iterator it" << std::endl
+                << tab2 << "    = m_entries.find(par.name);" << std::endl
+                << tab2 << "return it == m_entries.end() ? 0 : it->second->create_new(par);" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << "private :" << std::endl
+                << tab1 << "std::map<std::string, boost::shared_ptr<entry_type> > m_entries;" << std::endl
+                << "};" << std::endl
+                << std::endl;
+        }
+
+        // Returns the center, in degrees, of the usable area of the definition:
+        // around the central meridian and the standard parallels or origin
+        static void center_of(std::string const& parameters, double& lon, double& lat)
+        {
+            double zone = 0, lat_1 = 0, lat_2 = 0;
+            lon = 0;
+            lat = 0;
+            if (parameter_value(parameters, "zone", zone))
+            {
+                lon = -183.0 + 6.0 * zone;
+            }
+            else if (! parameter_value(parameters, "lonc", lon))
+            {
+                parameter_value(parameters, "lon_0", lon);
+            }
+
+            if (parameter_value(parameters, "lat_1", lat_1))
+            {
+                lat = parameter_value(parameters, "lat_2", lat_2)
+                    ? (lat_1 + lat_2) / 2.0
+                    : lat_1;
+            }
+            else if (! parameter_value(parameters, "lat_0", lat))
+            {
+                parameter_value(parameters, "lat_ts", lat);
+            }
+
+            // Keep the grid (5 degrees around the center) off the poles
+            lat = (std::max)(-80.0, (std::min)(80.0, lat));
+        }
+
+        void write_cases()
+        {
+            stream
+                << "struct epsg_case" << std::endl
+                << "{" << std::endl
+                << tab1 << "int code;" << std::endl
+                << tab1 << "char const* parameters;" << std::endl
+                << tab1 << "double lon, lat; // center of the grid, in degrees" << std::endl
+                << "};" << std::endl
+                << std::endl
+                << "epsg_case const cases[] =" << std::endl
+                << "{" << std::endl;
+
+            int count = 0;
+            BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+            {
+                BOOST_FOREACH(epsg_entry const& entry, m_epsg_entries)
+                {
+                    if (entry.prj_name == der.name)
+                    {
+                        double lon, lat;
+                        center_of(entry.parameters, lon, lat);
+                        stream << tab1 << "{ " << entry.epsg_code << ", \"" << entry.parameters
+                            << "\", " << lon << ", " << lat << " }," << std::endl;
+                        count++;
+                    }
+                }
+            }
+            if (count == 0)
+            {
+                // Avoid an empty array, the code 0 does not exist
+                stream << tab1 << "{ 0, \"+proj=" << projection_group << "\", 0, 0 }" << std::endl;
+            }
+
+            stream
+                << "};" << std::endl
+                << std::endl;
+        }
+
+        void write_functions()
+        {
+            stream
+                << "void round_trip(group_factory const& factory, epsg_case const& c)" << std::endl
+                << "{" << std::endl
+                << tab1 << "if (c.code == 0)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "return;" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "std::string const name = std::string(c.parameters).substr(6," << std::endl
+                << tab1 << "    std::string(c.parameters).find(' ') - 6);" << std::endl
+                << std::endl
+                << tab1 << "boost::shared_ptr<projection_type> prj;" << std::endl
+                << tab1 << "bgp::parameters par;" << std::endl
+                << tab1 << "try" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "par = bgp::init(c.parameters);" << std::endl
+                << tab2 << "prj.reset(factory.create_new(par));" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "if (! prj)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cout << c.code << \",\" << name << \",not created,0,0,0,0\" << std::endl;" << std::endl
+                << tab2 << "return;" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << tab1 << "// Grid of 5 degrees around the center, every half degree" << std::endl
+                << tab1 << "double const d2r = bg::math::d2r<double>();" << std::endl
+                << tab1 << "double const pi = bg::math::pi<double>();" << std::endl
+                << tab1 << "std::vector<point_type> lls;" << std::endl
+                << tab1 << "int failed = 0;" << std::endl
+                << tab1 << "double max_error = 0;" << std::endl
+                << tab1 << "for (int j = -10; j <= 10; j++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (int i = -10; i <= 10; i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "double const lat = (c.lat + j * 0.5) * d2r;" << std::endl
+                << tab3 << "point_type const ll((c.lon + i * 0.5) * d2r, lat);" << std::endl
+                << tab3 << "point_type xy, back;" << std::endl
+                << tab3 << "try" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "prj->forward(ll, xy);" << std::endl
+                << tab4 << "prj->inverse(xy, back);" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "failed++;" << std::endl
+                << tab4 << "continue;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "double dlon = bg::get<0>(back) - bg::get<0>(ll);" << std::endl
+                << tab3 << "while (dlon > pi) dlon -= 2.0 * pi;" << std::endl
+                << tab3 << "while (dlon < -pi) dlon += 2.0 * pi;" << std::endl
+                << tab3 << "dlon *= std::cos(lat);" << std::endl
+                << tab3 << "double const dlat = bg::get<1>(back) - lat;" << std::endl
+                << tab3 << "double const error = par.a * std::sqrt(dlon * dlon + dlat * dlat);" << std::endl
+                << tab3 << "if (! (error == error)) // NaN" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "failed++;" << std::endl
+                << tab4 << "continue;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "max_error = (std::max)(max_error, error);" << std::endl
+                << tab3 << "lls.push_back(ll);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl
+                << tab1 << "// Time the round trips of the valid points for at least 20 milliseconds" << std::endl
+                << tab1 << "volatile double sink = 0.0;" << std::endl
+                << tab1 << "long repetitions = 0;" << std::endl
+                << tab1 << "std::clock_t const start = std::clock();" << std::endl
+                << tab1 << "std::clock_t elapsed = 0;" << std::endl
+                << tab1 << "while (! lls.empty() && elapsed < CLOCKS_PER_SEC / 50)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (std::size_t i = 0; i < lls.size(); i++)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "point_type xy, back;" << std::endl
+                << tab3 << "prj->forward(lls[i], xy);" << std::endl
+                << tab3 << "prj->inverse(xy, back);" << std::endl
+                << tab3 << "sink = sink + bg::get<0>(back);" << std::endl
+                << tab2 << "}" << std::endl
+                << tab2 << "repetitions++;" << std::endl
+                << tab2 << "elapsed = std::clock() - start;" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "double const ns = lls.empty() ? 0.0" << std::endl
+                << tab1 << "    : 1.0e9 * elapsed / CLOCKS_PER_SEC / (double(repetitions) * lls.size());" << std::endl
+                << std::endl
+                << tab1 << "std::cout << c.code << \",\" << name << \",ok,\" << lls.size() << \",\" << failed" << std::endl
+                << tab1 << "    << \",\" << max_error << \",\" << ns << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl;
+        }
+
+        projection_properties& m_prop;
+        std::ostream& stream;
+        std::string projection_group;
+        std::vector<epsg_entry> const& m_epsg_entries;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_EPSG_WRITER_HPP
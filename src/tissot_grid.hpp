@@ -0,0 +1,447 @@
+#ifndef TISSOT_GRID_HPP
+#define TISSOT_GRID_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Analyzes a forward body for transforming grids of nlon x nlat points.
+// It finds on which of the longitude and the latitude each local (and xy)
+// depends. The forward is:
+// - separable, if x depends on the longitude only and y on the latitude only
+//   (true cylindricals), such that a grid takes nlon + nlat - 1 forwards
+// - split into rows, if there are statements depending on the latitude only
+//   (e.g. pseudocylindricals), which are then calculated once per row
+// This is done conservatively: the body should consist of statements, each
+// optionally preceded by an if-condition on the same line. Other control
+// flow (blocks, loops, returns) or writes other than to locals leave the
+// forward as it is, transforming grids point by point.
+class forward_grid_analyzer
+{
+public :
+    forward_grid_analyzer(projection& proj, std::set<std::string> const& pure)
+        : m_proj(proj)
+        , m_pure(pure)
+    {
+        std::set<std::string> const math = pure_functions();
+        m_pure.insert(math.begin(), math.end());
+    }
+
+    // Returns true if the forward can be transformed faster than per point
+    bool apply()
+    {
+        if (! parse() || ! collect())
+        {
+            return false;
+        }
+        propagate();
+
+        bool const separable = (m_depends["xy_x"] & latitude) == 0
+            && (m_depends["xy_y"] & longitude) == 0;
+        bool const rows = split_rows();
+        if (separable)
+        {
+            m_proj.grid = "separable";
+        }
+        else if (rows)
+        {
+            m_proj.grid = "rows";
+        }
+        return separable || rows;
+    }
+
+private :
+
+    enum { longitude = 1, latitude = 2 };
+
+    struct statement
+    {
+        std::vector<std::string> lines;
+        std::string code;
+        bool declaration_only;
+        std::set<std::string> assigned, read;
+        statement() : declaration_only(false) {}
+    };
+
+    // Groups the lines into statements, which might span multiple lines
+    bool parse()
+    {
+        std::vector<std::string> const code = blank_comments(m_proj.lines);
+        statement current;
+        int depth = 0;
+        for (std::size_t i = 0; i < code.size(); i++)
+        {
+            std::string const trimmed = boost::trim_copy(code[i]);
+            if (trimmed.empty())
+            {
+                if (! current.lines.empty())
+                {
+                    current.lines.push_back(m_proj.lines[i]);
+                }
+                continue;
+            }
+            if (trimmed.find_first_of("{}#") != std::string::npos
+                || (current.lines.empty() && starts_with_keyword(trimmed)))
+            {
+                return false;
+            }
+            current.lines.push_back(m_proj.lines[i]);
+            current.code += (current.code.empty() ? "" : " ") + trimmed;
+            for (std::string::size_type j = 0; j < trimmed.size(); j++)
+            {
+                depth += trimmed[j] == '(' ? 1 : trimmed[j] == ')' ? -1 : 0;
+            }
+            if (depth == 0 && boost::ends_with(trimmed, ";"))
+            {
+                m_statements.push_back(current);
+                current = statement();
+            }
+        }
+        return current.lines.empty() && ! m_statements.empty();
+    }
+
+    static bool starts_with_keyword(std::string const& code)
+    {
+        char const* keywords[] = { "else", "for", "while", "do", "switch",
+            "case", "default", "return", "goto", "break", "continue", "static" };
+        BOOST_FOREACH(char const* keyword, keywords)
+        {
+            if (find_name(code, keyword) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Collects the declared locals, and per statement what it assigns and reads
+    bool collect()
+    {
+        m_depends["lp_lon"] = longitude;
+        m_depends["lp_lat"] = latitude;
+        m_depends["xy_x"] = 0;
+        m_depends["xy_y"] = 0;
+
+        BOOST_FOREACH(statement& st, m_statements)
+        {
+            std::string code = st.code;
+            if (find_name(code, "if") == 0)
+            {
+                // Condition and (single) statement
+                std::string::size_type const open = code.find('(');
+                std::string::size_type const close = closing(code, open);
+                if (close == std::string::npos)
+                {
+                    return false;
+                }
+                std::string const rest = boost::trim_copy(code.substr(close + 1));
+                if (starts_with_keyword(rest) || find_name(rest, "if") == 0)
+                {
+                    return false;
+                }
+                code = rest;
+            }
+
+            std::string declarators;
+            if (declaration(code, declarators))
+            {
+                if (code != st.code || ! declare(declarators, st))
+                {
+                    return false;
+                }
+            }
+        }
+
+        BOOST_FOREACH(statement& st, m_statements)
+        {
+            if (st.declaration_only)
+            {
+                continue;
+            }
+            if (! collect_assignments(st.code, st.assigned))
+            {
+                return false;
+            }
+            std::vector<std::string> const names = names_in(st.code);
+            BOOST_FOREACH(std::string const& name, names)
+            {
+                if (m_depends.count(name) > 0)
+                {
+                    st.read.insert(name);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns true if the code declares locals, with the declarators
+    static bool declaration(std::string const& code, std::string& declarators)
+    {
+        char const* types[] = { "CalculationType", "geographic_type", "cartesian_type",
+            "double", "float", "int", "long", "bool" };
+        std::string rest = code;
+        if (find_name(rest, "const") == 0)
+        {
+            rest = boost::trim_copy(rest.substr(5));
+        }
+        BOOST_FOREACH(char const* type, types)
+        {
+            if (find_name(rest, type) == 0)
+            {
+                rest = boost::trim_copy(rest.substr(std::strlen(type)));
+                if (find_name(rest, "const") == 0)
+                {
+                    rest = boost::trim_copy(rest.substr(5));
+                }
+                declarators = rest;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool declare(std::string const& declarators, statement& st)
+    {
+        if (declarators.find_first_of("[*&") != std::string::npos)
+        {
+            return false;
+        }
+        st.declaration_only = declarators.find('=') == std::string::npos;
+
+        int depth = 0;
+        bool expect_name = true;
+        for (std::string::size_type j = 0; j < declarators.size(); j++)
+        {
+            char const c = declarators[j];
+            if (expect_name && is_name_char(c))
+            {
+                std::string const name = name_at(declarators, j);
+                if (name.empty() || m_depends.count(name) > 0)
+                {
+                    return false;
+                }
+                m_depends[name] = 0;
+                j += name.size() - 1;
+                expect_name = false;
+            }
+            depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+            if (c == ',' && depth == 0)
+            {
+                expect_name = true;
+            }
+        }
+        return true;
+    }
+
+    // Collects the names of all locals which are assigned, incremented, of
+    // which the address is taken, or which are passed to functions which are
+    // not known to be pure (and might be taken by reference). Returns false
+    // if anything else than a local is assigned
+    bool collect_assignments(std::string const& code, std::set<std::string>& assigned) const
+    {
+        for (std::string::size_type j = 0; j < code.size(); j++)
+        {
+            char const c = code[j];
+            bool const next_is_eq = j + 1 < code.size() && code[j + 1] == '=';
+            if (c == '=' && ! next_is_eq
+                && (j == 0 || std::string("=!<>").find(code[j - 1]) == std::string::npos))
+            {
+                std::string::size_type end = j;
+                if (j > 0 && std::string("+-*/%&|^").find(code[j - 1]) != std::string::npos)
+                {
+                    end = j - 1;
+                }
+                if (! assign(lvalue_root(code, end), assigned))
+                {
+                    return false;
+                }
+            }
+            else if ((c == '+' || c == '-') && j + 1 < code.size() && code[j + 1] == c)
+            {
+                std::string const before = lvalue_root(code, j);
+                std::string const after = name_at(code, j + 2);
+                if ((! before.empty() && ! assign(before, assigned))
+                    || (! after.empty() && ! assign(after, assigned)))
+                {
+                    return false;
+                }
+                j++;
+            }
+            else if (c == '&' && j + 1 < code.size() && code[j + 1] != '&'
+                && (j == 0 || code[j - 1] != '&'))
+            {
+                assign_local(name_at(code, j + 1), assigned);
+            }
+            else if (c == '(' && j > 0)
+            {
+                std::string const function = function_before(code, j);
+                if (! function.empty() && m_pure.count(function) == 0)
+                {
+                    std::string::size_type const end = closing(code, j);
+                    std::vector<std::string> const names = names_in(
+                        code.substr(j + 1, end == std::string::npos ? std::string::npos : end - j - 1));
+                    BOOST_FOREACH(std::string const& name, names)
+                    {
+                        assign_local(name, assigned);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool assign(std::string const& name, std::set<std::string>& assigned) const
+    {
+        if (m_depends.count(name) == 0)
+        {
+            return false;
+        }
+        assigned.insert(name);
+        return true;
+    }
+
+    void assign_local(std::string const& name, std::set<std::string>& assigned) const
+    {
+        if (m_depends.count(name) > 0)
+        {
+            assigned.insert(name);
+        }
+    }
+
+    // Each local depends on what the statements assigning it read
+    void propagate()
+    {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            BOOST_FOREACH(statement const& st, m_statements)
+            {
+                int const depends = statement_depends(st);
+                BOOST_FOREACH(std::string const& name, st.assigned)
+                {
+                    int& target = m_depends[name];
+                    if ((target | depends) != target)
+                    {
+                        target |= depends;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    int statement_depends(statement const& st) const
+    {
+        int result = 0;
+        BOOST_FOREACH(std::string const& name, st.read)
+        {
+            result |= m_depends.find(name)->second;
+        }
+        return result;
+    }
+
+    bool per_row(statement const& st) const
+    {
+        if (st.assigned.empty())
+        {
+            return (statement_depends(st) & longitude) == 0;
+        }
+        BOOST_FOREACH(std::string const& name, st.assigned)
+        {
+            if ((m_depends.find(name)->second & longitude) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Splits the statements into declarations, statements per row and per
+    // point. Statements per point should not read locals which are assigned
+    // per row later on, because all statements per row are moved before them
+    bool split_rows()
+    {
+        std::vector<bool> row(m_statements.size(), false);
+        bool any_row = false, any_point = false;
+        for (std::size_t i = 0; i < m_statements.size(); i++)
+        {
+            statement const& st = m_statements[i];
+            if (! st.declaration_only)
+            {
+                row[i] = per_row(st);
+                any_row = any_row || row[i];
+                any_point = any_point || ! row[i];
+            }
+        }
+        if (! any_row || ! any_point)
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < m_statements.size(); i++)
+        {
+            if (m_statements[i].declaration_only || row[i])
+            {
+                continue;
+            }
+            for (std::size_t j = i + 1; j < m_statements.size(); j++)
+            {
+                if (! row[j])
+                {
+                    continue;
+                }
+                BOOST_FOREACH(std::string const& name, m_statements[j].assigned)
+                {
+                    if (m_statements[i].read.count(name) > 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < m_statements.size(); i++)
+        {
+            statement const& st = m_statements[i];
+            std::vector<std::string>& target = st.declaration_only ? m_proj.row_declarations
+                : row[i] ? m_proj.row_lines
+                : m_proj.point_lines;
+            target.insert(target.end(), st.lines.begin(), st.lines.end());
+        }
+        return true;
+    }
+
+    projection& m_proj;
+    std::set<std::string> m_pure;
+    std::vector<statement> m_statements;
+    std::map<std::string, int> m_depends;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_GRID_HPP
@@ -0,0 +1,491 @@
+#ifndef TISSOT_LOCALIZE_HPP
+#define TISSOT_LOCALIZE_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Classifies the scalar members of par_<group> by their usage, and changes
+// members which do not need to be members into local variables:
+// - members used nowhere are removed
+// - members used by setup only, in one function, become locals of the setup
+// - members not used by setup, but written in forward/inverse (scratch
+//   variables), become locals of the forward/inverse functions using them,
+//   if each of these functions starts using it by an unconditional
+//   assignment; otherwise they are kept and reported, as a call might read
+//   the value of the previous call
+// Members read by forward/inverse and assigned by setup are kept. Members
+// written by both setup and forward/inverse are kept too, and reported, as
+// they are state changed by forward/inverse.
+// Locals are initialized with zero, as Proj4 clears the projection parameters
+class proj_parameter_localizer
+{
+public :
+    proj_parameter_localizer(projection_properties& prop)
+        : m_prop(prop)
+    {}
+
+    void apply()
+    {
+        if (m_prop.proj_parameters.empty()
+            || ! m_prop.link_type.empty()
+            || ! collect_members()
+            || passes_whole_struct())
+        {
+            return;
+        }
+
+        std::set<std::string> removed;
+        for (std::map<std::string, std::string>::const_iterator it = m_members.begin();
+            it != m_members.end(); ++it)
+        {
+            std::string const& name = it->first;
+            std::string const& type = it->second;
+            if (used_elsewhere(name))
+            {
+                continue;
+            }
+
+            std::vector<std::vector<std::string>*> setups = setup_bodies_using(name);
+            std::vector<std::vector<std::string>*> functions;
+            bool written = false;
+            BOOST_FOREACH(projection& proj, m_prop.projections)
+            {
+                if (uses(proj.lines, "m_proj_parm." + name))
+                {
+                    functions.push_back(&proj.lines);
+                    written = written || writes(proj.lines, "m_proj_parm." + name);
+                }
+            }
+
+            if (setups.empty() && functions.empty())
+            {
+                removed.insert(name);
+                m_prop.report["proj parameters removed"]++;
+            }
+            else if (functions.empty())
+            {
+                // Setup only. If it is used in the common setup function,
+                // it may be assigned by that and used in the specific setup
+                bool const common = uses(m_prop.setup_functions, "proj_parm." + name);
+                if ((! common || setups.size() == 1u)
+                    && localize(setups, "proj_parm." + name, name, type))
+                {
+                    removed.insert(name);
+                    m_prop.report["proj parameters localized in setup"]++;
+                }
+            }
+            else if (written && setups.empty())
+            {
+                if (! assigned_first(functions, "m_proj_parm." + name))
+                {
+                    m_prop.report["proj parameters read before assigned in forward/inverse"]++;
+                }
+                else if (localize(functions, "m_proj_parm." + name, name, type))
+                {
+                    removed.insert(name);
+                    m_prop.report["proj parameters localized in forward/inverse"]++;
+                }
+            }
+            else if (written)
+            {
+                m_prop.report["proj parameters written in forward/inverse"]++;
+            }
+        }
+
+        if (! removed.empty())
+        {
+            remove_declarations(removed);
+        }
+    }
+
+private :
+
+    // Collects scalar members (double or int), with their types
+    bool collect_members()
+    {
+        std::vector<std::string> const code = blank_comments(m_prop.proj_parameters);
+        BOOST_FOREACH(std::string const& line, code)
+        {
+            std::string type, names;
+            if (! parse_declaration(line, type, names))
+            {
+                continue;
+            }
+            std::vector<std::string> list;
+            split(names, list, " ,\t");
+            BOOST_FOREACH(std::string const& name, list)
+            {
+                m_members[name] = type;
+            }
+        }
+        return ! m_members.empty();
+    }
+
+    // Parses a line like "double n, c;" into its type and names
+    static bool parse_declaration(std::string const& line, std::string& type, std::string& names)
+    {
+        std::string code = boost::trim_copy(line);
+        if (boost::starts_with(code, "double "))
+        {
+            type = "double";
+        }
+        else if (boost::starts_with(code, "int "))
+        {
+            type = "int";
+        }
+        else
+        {
+            return false;
+        }
+        if (! boost::ends_with(code, ";")
+            || code.find_first_of("*[(=&<:") != std::string::npos
+            || std::count(code.begin(), code.end(), ';') != 1)
+        {
+            return false;
+        }
+        names = code.substr(type.size(), code.size() - type.size() - 1);
+        std::vector<std::string> list;
+        split(names, list, " ,\t");
+        BOOST_FOREACH(std::string const& name, list)
+        {
+            if (! is_name(name))
+            {
+                return false;
+            }
+        }
+        return ! list.empty();
+    }
+
+    // Returns true if the struct itself is passed somewhere (other than
+    // to the common setup), such that its members might be used there
+    bool passes_whole_struct() const
+    {
+        std::vector<std::vector<std::string> const*> bodies;
+        bodies.push_back(&m_prop.setup_functions);
+        bodies.push_back(&m_prop.inlined_functions);
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            bodies.push_back(&der.constructor_lines);
+        }
+        BOOST_FOREACH(std::vector<std::string> const* body, bodies)
+        {
+            BOOST_FOREACH(std::string const& line, *body)
+            {
+                if (boost::starts_with(boost::trim_copy(line), "setup("))
+                {
+                    continue;
+                }
+                if (whole_use(line, "proj_parm"))
+                {
+                    return true;
+                }
+            }
+        }
+        BOOST_FOREACH(projection const& proj, m_prop.projections)
+        {
+            BOOST_FOREACH(std::string const& line, proj.lines)
+            {
+                if (whole_use(line, "m_proj_parm"))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Returns true if the name is used, not followed by a member
+    static bool whole_use(std::string const& line, std::string const& name)
+    {
+        std::string::size_type loc = find_name(line, name, 0);
+        while (loc != std::string::npos)
+        {
+            std::string::size_type const end = loc + name.size();
+            if (end >= line.size() || line[end] != '.')
+            {
+                return true;
+            }
+            loc = find_name(line, name, end);
+        }
+        return false;
+    }
+
+    bool used_elsewhere(std::string const& name) const
+    {
+        return uses(m_prop.inlined_functions, "proj_parm." + name)
+            || uses(m_prop.inlined_functions, "m_proj_parm." + name)
+            || uses(m_prop.setup_extra_code, "proj_parm." + name)
+            || uses(m_prop.extra_member_initialization_list, "proj_parm." + name);
+    }
+
+    std::vector<std::vector<std::string>*> setup_bodies_using(std::string const& name)
+    {
+        std::vector<std::vector<std::string>*> result;
+        if (uses(m_prop.setup_functions, "proj_parm." + name))
+        {
+            result.push_back(&m_prop.setup_functions);
+        }
+        BOOST_FOREACH(derived& der, m_prop.derived_projections)
+        {
+            if (uses(der.constructor_lines, "proj_parm." + name))
+            {
+                result.push_back(&der.constructor_lines);
+            }
+        }
+        return result;
+    }
+
+    static bool uses(std::vector<std::string> const& lines, std::string const& member)
+    {
+        BOOST_FOREACH(std::string const& line, lines)
+        {
+            if (find_name(line, member, 0) != std::string::npos)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns true if the member is assigned, incremented or passed by address
+    static bool writes(std::vector<std::string> const& lines, std::string const& member)
+    {
+        BOOST_FOREACH(std::string const& line, lines)
+        {
+            std::string::size_type loc = find_name(line, member, 0);
+            while (loc != std::string::npos)
+            {
+                std::string const before = boost::trim_right_copy(line.substr(0, loc));
+                std::string const after = boost::trim_left_copy(line.substr(loc + member.size()));
+                if ((boost::ends_with(before, "&") && ! boost::ends_with(before, "&&"))
+                    || boost::ends_with(before, "++") || boost::ends_with(before, "--")
+                    || boost::starts_with(after, "++") || boost::starts_with(after, "--")
+                    || (boost::starts_with(after, "=") && ! boost::starts_with(after, "=="))
+                    || boost::starts_with(after, "+=") || boost::starts_with(after, "-=")
+                    || boost::starts_with(after, "*=") || boost::starts_with(after, "/="))
+                {
+                    return true;
+                }
+                loc = find_name(line, member, loc + member.size());
+            }
+        }
+        return false;
+    }
+
+    // Returns true if the first use of the member in each body is an
+    // assignment on the top level of that body, not conditional (e.g. by
+    // a preceding if or else without braces) and not reading the member
+    // itself. That assignment dominates all reads of the member
+    static bool assigned_first(std::vector<std::vector<std::string>*> const& bodies,
+                std::string const& member)
+    {
+        BOOST_FOREACH(std::vector<std::string>* body, bodies)
+        {
+            std::vector<std::string> const code = blank_comments(*body);
+            std::string previous = ";";
+            int depth = 0;
+            bool assigned = false;
+            BOOST_FOREACH(std::string const& line, code)
+            {
+                std::string statement = boost::trim_copy(line);
+                if (find_name(statement, member, 0) != std::string::npos)
+                {
+                    if (boost::starts_with(statement, "this->"))
+                    {
+                        statement.erase(0, 6);
+                    }
+                    if (depth != 0
+                        || previous.find_last_of(";{}") != previous.size() - 1
+                        || ! boost::starts_with(statement, member))
+                    {
+                        return false;
+                    }
+                    std::string const rest = boost::trim_left_copy(statement.substr(member.size()));
+                    if (! boost::starts_with(rest, "=")
+                        || boost::starts_with(rest, "==")
+                        || find_name(rest, member, 0) != std::string::npos
+                        || std::count(rest.begin(), rest.end(), ';') != 1
+                        || ! boost::ends_with(rest, ";"))
+                    {
+                        return false;
+                    }
+                    assigned = true;
+                    break;
+                }
+                depth += static_cast<int>(std::count(statement.begin(), statement.end(), '{'))
+                    - static_cast<int>(std::count(statement.begin(), statement.end(), '}'));
+                if (! statement.empty())
+                {
+                    previous = statement;
+                }
+            }
+            if (! assigned)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Replaces the member by a local in all bodies, if its name is not used
+    // otherwise there
+    static bool localize(std::vector<std::vector<std::string>*> const& bodies,
+                std::string const& member, std::string const& name, std::string const& type)
+    {
+        BOOST_FOREACH(std::vector<std::string>* body, bodies)
+        {
+            BOOST_FOREACH(std::string const& line, *body)
+            {
+                std::string stripped = line;
+                replace_member(stripped, member, "");
+                if (contains_name(stripped, name))
+                {
+                    return false;
+                }
+            }
+        }
+
+        BOOST_FOREACH(std::vector<std::string>* body, bodies)
+        {
+            BOOST_FOREACH(std::string& line, *body)
+            {
+                replace_member(line, member, name);
+            }
+            body->insert(body->begin(), tab1 + type + " " + name
+                + (type == "double" ? " = 0.0;" : " = 0;"));
+        }
+        return true;
+    }
+
+    // Replaces the member (also if preceded by this->) by the name
+    static void replace_member(std::string& line, std::string const& member, std::string const& name)
+    {
+        std::string const self = "this->";
+        std::string::size_type loc = find_name(line, member, 0);
+        while (loc != std::string::npos)
+        {
+            std::string::size_type begin = loc;
+            if (loc >= self.size() && line.compare(loc - self.size(), self.size(), self) == 0)
+            {
+                begin -= self.size();
+            }
+            line.replace(begin, loc + member.size() - begin, name);
+            loc = find_name(line, member, begin + name.size());
+        }
+    }
+
+    void remove_declarations(std::set<std::string> const& removed)
+    {
+        std::vector<std::string> const code = blank_comments(m_prop.proj_parameters);
+        std::vector<std::string> result;
+        bool any = false;
+        for (std::size_t i = 0; i < m_prop.proj_parameters.size(); i++)
+        {
+            std::string const& line = m_prop.proj_parameters[i];
+            std::string type, names;
+            if (! parse_declaration(code[i], type, names))
+            {
+                result.push_back(line);
+                any = any || ! boost::trim_copy(code[i]).empty();
+                continue;
+            }
+
+            std::vector<std::string> list, kept;
+            split(names, list, " ,\t");
+            BOOST_FOREACH(std::string const& name, list)
+            {
+                if (removed.count(name) == 0)
+                {
+                    kept.push_back(name);
+                }
+            }
+            if (kept.size() == list.size())
+            {
+                result.push_back(line);
+                any = true;
+            }
+            else if (! kept.empty())
+            {
+                std::string const indent = line.substr(0, line.find_first_not_of(" \t"));
+                result.push_back(indent + type + " " + boost::join(kept, ", ") + ";");
+                any = true;
+            }
+        }
+
+        if (any)
+        {
+            m_prop.proj_parameters = result;
+            if (! uses_struct(m_prop.setup_functions)
+                && ! m_prop.setup_functions.empty()
+                && ! uses_ignored_struct(m_prop.setup_functions))
+            {
+                m_prop.setup_functions.insert(m_prop.setup_functions.begin(),
+                    tab1 + "boost::ignore_unused(proj_parm);");
+            }
+        }
+        else
+        {
+            // No members left, the setup functions get no struct
+            m_prop.proj_parameters.clear();
+            m_prop.setup_functions.erase
+                (
+                    std::remove_if(m_prop.setup_functions.begin(),
+                        m_prop.setup_functions.end(), ignores_struct),
+                    m_prop.setup_functions.end()
+                );
+        }
+    }
+
+    static bool uses_struct(std::vector<std::string> const& lines)
+    {
+        BOOST_FOREACH(std::string const& line, lines)
+        {
+            if (boost::contains(line, "proj_parm."))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool ignores_struct(std::string const& line)
+    {
+        return boost::contains(line, "ignore_unused(proj_parm)");
+    }
+
+    static bool uses_ignored_struct(std::vector<std::string> const& lines)
+    {
+        return std::find_if(lines.begin(), lines.end(), ignores_struct) != lines.end();
+    }
+
+    projection_properties& m_prop;
+    std::map<std::string, std::string> m_members;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_LOCALIZE_HPP
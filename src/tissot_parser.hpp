@@ -309,6 +309,16 @@ class proj4_parser
                             boost::replace_first(trimmed, "define", "");
                             boost::trim(trimmed);
                             std::string::size_type space = trimmed.find(' ');
+                            std::string::size_type open = trimmed.find('(');
+                            if (open != std::string::npos && open < space)
+                            {
+                                // Function-like macro, arguments might contain spaces
+                                std::string::size_type close = trimmed.find(')', open);
+                                if (close != std::string::npos)
+                                {
+                                    space = trimmed.find(' ', close);
+                                }
+                            }
                             if (space != std::string::npos)
                             {
                                 // Split it
@@ -0,0 +1,263 @@
+#ifndef TISSOT_PRECISION_WRITER_HPP
+#define TISSOT_PRECISION_WRITER_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Writes a program reporting the precision of the float instantiation of
+// each projection, compared to the double instantiation, on a standard grid
+class proj4_precision_writer
+{
+    public :
+        proj4_precision_writer(projection_properties& projpar
+                , std::string const& group
+                , std::ostream& str)
+            : m_prop(projpar)
+            , stream(str)
+            , projection_group(group)
+        {
+        }
+
+        void write()
+        {
+            write_header();
+            write_functions();
+
+            stream
+                << "int main(int argc, char** argv)" << std::endl
+                << "{" << std::endl
+                << tab1 << "// Extra parameters (e.g. +lat_1=30) can be passed on the command line" << std::endl
+                << tab1 << "std::string extra;" << std::endl
+                << tab1 << "for (int i = 1; i < argc; i++)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "extra += std::string(\" \") + argv[i];" << std::endl
+                << tab1 << "}" << std::endl
+                << std::endl;
+
+            // Every group is instantiated in float, also groups using other
+            // projections (igh) or linking to them (ob_tran)
+            if (! m_prop.valid)
+            {
+                stream
+                    << tab1 << "std::cout << \"" << projection_group
+                    << ": no float instantiation\" << std::endl;" << std::endl;
+            }
+            else
+            {
+                BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+                {
+                    BOOST_FOREACH(model const& mod, der.models)
+                    {
+                        write_report(der, mod);
+                    }
+                }
+
+                // The results of these are converted, but they calculate in double
+                if (! m_prop.double_calculations.empty())
+                {
+                    stream
+                        << tab1 << "std::cout << \"" << projection_group
+                        << ": float calculates in double within "
+                        << boost::join(m_prop.double_calculations, ", ")
+                        << "\" << std::endl;" << std::endl;
+                }
+            }
+
+            stream
+                << tab1 << "return 0;" << std::endl
+                << "}" << std::endl;
+        }
+
+    private :
+
+        void write_header()
+        {
+            stream
+                << "// Precision of the float instantiation of " << projection_group
+                << ", compared to double" << std::endl
+                << "// Generated by tissot, compile it against the generated projection" << std::endl
+                << std::endl
+                << "#include <cmath>" << std::endl
+                << "#include <iostream>" << std::endl
+                << "#include <string>" << std::endl
+                << std::endl
+                << "#include <boost/geometry.hpp>" << std::endl
+                << include_projections << "/parameters.hpp>" << std::endl;
+            if (! m_prop.link_type.empty())
+            {
+                // The default link is created by the factory
+                stream << include_projections << "/factory.hpp>" << std::endl;
+            }
+            stream
+                << include_projections << "/proj/" << projection_group << ".hpp>" << std::endl
+                << std::endl
+                << "namespace bg = boost::geometry;" << std::endl
+                << "namespace bgp = boost::geometry::projections;" << std::endl
+                << std::endl
+                << "typedef bg::model::point<double, 2, bg::cs::cartesian> double_point;" << std::endl
+                << "typedef bg::model::point<float, 2, bg::cs::cartesian> float_point;" << std::endl
+                << std::endl;
+        }
+
+        void write_functions()
+        {
+            // The grid is in degrees, every 5 degrees, avoiding the poles
+            // and the antimeridian where many projections are undefined
+            stream
+                << "template <typename Double, typename Float>" << std::endl
+                << "void report_forward(std::string const& name, bgp::parameters const& par)" << std::endl
+                << "{" << std::endl
+                << tab1 << "Double const prj_double(par);" << std::endl
+                << tab1 << "Float const prj_float(par);" << std::endl
+                << tab1 << "double const d2r = bg::math::d2r<double>();" << std::endl
+                << tab1 << "double max_distance = 0, sum = 0;" << std::endl
+                << tab1 << "int count = 0, failed = 0;" << std::endl
+                << tab1 << "for (int lat = -85; lat <= 85; lat += 5)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (int lon = -175; lon <= 175; lon += 5)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "double_point const ll_double(lon * d2r, lat * d2r);" << std::endl
+                << tab3 << "float_point const ll_float(float(lon * d2r), float(lat * d2r));" << std::endl
+                << tab3 << "double_point xy_double;" << std::endl
+                << tab3 << "float_point xy_float;" << std::endl
+                << tab3 << "try" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "prj_double.forward(ll_double, xy_double);" << std::endl
+                << tab4 << "prj_float.forward(ll_float, xy_float);" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "failed++;" << std::endl
+                << tab4 << "continue;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "double const dx = bg::get<0>(xy_double) - bg::get<0>(xy_float);" << std::endl
+                << tab3 << "double const dy = bg::get<1>(xy_double) - bg::get<1>(xy_float);" << std::endl
+                << tab3 << "double const distance = std::sqrt(dx * dx + dy * dy);" << std::endl
+                << tab3 << "if (distance == distance) // not NaN" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "max_distance = (std::max)(max_distance, distance);" << std::endl
+                << tab4 << "sum += distance * distance;" << std::endl
+                << tab4 << "count++;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "std::cout << name << \" forward: max \" << max_distance" << std::endl
+                << tab1 << "    << \" m, rms \" << std::sqrt(sum / (std::max)(count, 1))" << std::endl
+                << tab1 << "    << \" m, points \" << count << \", failed \" << failed << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl
+                << "template <typename Double, typename Float>" << std::endl
+                << "void report_inverse(std::string const& name, bgp::parameters const& par)" << std::endl
+                << "{" << std::endl
+                << tab1 << "Double const prj_double(par);" << std::endl
+                << tab1 << "Float const prj_float(par);" << std::endl
+                << tab1 << "double const d2r = bg::math::d2r<double>();" << std::endl
+                << tab1 << "double max_distance = 0;" << std::endl
+                << tab1 << "int count = 0, failed = 0;" << std::endl
+                << tab1 << "for (int lat = -85; lat <= 85; lat += 5)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "for (int lon = -175; lon <= 175; lon += 5)" << std::endl
+                << tab2 << "{" << std::endl
+                << tab3 << "double_point const ll(lon * d2r, lat * d2r);" << std::endl
+                << tab3 << "double_point xy, ll_double;" << std::endl
+                << tab3 << "float_point ll_float;" << std::endl
+                << tab3 << "try" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "prj_double.forward(ll, xy);" << std::endl
+                << tab4 << "prj_double.inverse(xy, ll_double);" << std::endl
+                << tab4 << "prj_float.inverse(float_point(float(bg::get<0>(xy)), float(bg::get<1>(xy))), ll_float);" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "failed++;" << std::endl
+                << tab4 << "continue;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab3 << "// Difference on the sphere of the semi-major axis" << std::endl
+                << tab3 << "double const dlon = (bg::get<0>(ll_double) - bg::get<0>(ll_float)) * std::cos(lat * d2r);" << std::endl
+                << tab3 << "double const dlat = bg::get<1>(ll_double) - bg::get<1>(ll_float);" << std::endl
+                << tab3 << "double const distance = par.a * std::sqrt(dlon * dlon + dlat * dlat);" << std::endl
+                << tab3 << "if (distance == distance) // not NaN" << std::endl
+                << tab3 << "{" << std::endl
+                << tab4 << "max_distance = (std::max)(max_distance, distance);" << std::endl
+                << tab4 << "count++;" << std::endl
+                << tab3 << "}" << std::endl
+                << tab2 << "}" << std::endl
+                << tab1 << "}" << std::endl
+                << tab1 << "std::cout << name << \" inverse: max \" << max_distance" << std::endl
+                << tab1 << "    << \" m, points \" << count << \", failed \" << failed << std::endl;" << std::endl
+                << "}" << std::endl
+                << std::endl;
+        }
+
+        void write_report(derived const& der, model const& mod)
+        {
+            std::string name = der.name + "_" + mod.name;
+            if (mod.subgroup != projection_group)
+            {
+                name = mod.subgroup + "_" + mod.name;
+            }
+
+            // Spheroid models are used for spheres
+            std::string const ellps = mod.name == "spheroid" ? "+R=6370997" : "+ellps=WGS84";
+            std::string const types = "<bgp::" + name + "<double_point, double_point>, bgp::"
+                + name + "<float_point, float_point, bgp::parameters" + link_argument() + ", float> >";
+
+            // Projections requiring parameters throw if they are not passed
+            stream
+                << tab1 << "try" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "bgp::parameters const par = bgp::init(\"+proj=" << der.name
+                << " " << ellps << "\" + extra);" << std::endl
+                << tab2 << "report_forward" << types << "(\"" << name << "\", par);" << std::endl;
+            if (mod.has_inverse)
+            {
+                stream << tab2 << "report_inverse" << types << "(\"" << name << "\", par);" << std::endl;
+            }
+            stream
+                << tab1 << "}" << std::endl
+                << tab1 << "catch (bgp::proj_exception const&)" << std::endl
+                << tab1 << "{" << std::endl
+                << tab2 << "std::cout << \"" << name << ": not initialized, pass its parameters\" << std::endl;" << std::endl
+                << tab1 << "}" << std::endl;
+        }
+
+        // The (default) link type for the float instantiation
+        std::string link_argument() const
+        {
+            if (m_prop.link_type.empty())
+            {
+                return "";
+            }
+            std::string link = m_prop.link_type;
+            boost::replace_all(link, "Geographic", "float_point");
+            boost::replace_all(link, "Cartesian", "float_point");
+            boost::replace_all(link, "<projection<", "<bgp::projection<");
+            return ", " + link + (boost::ends_with(link, ">") ? " " : "");
+        }
+
+        projection_properties& m_prop;
+        std::ostream& stream;
+        std::string projection_group;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_PRECISION_WRITER_HPP
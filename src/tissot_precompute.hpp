@@ -0,0 +1,777 @@
+#ifndef TISSOT_PRECOMPUTE_HPP
+#define TISSOT_PRECOMPUTE_HPP
+
+// Tissot, converts projecton source code (Proj4) to Boost.Geometry
+// (or potentially other source code)
+//
+// Copyright (c) 2015 Barend Gehrels, Amsterdam, the Netherlands.
+//
+// Use, modification and distribution is subject to the Boost Software License,
+// Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include "tissot_structs.hpp"
+#include "tissot_util.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace boost { namespace geometry { namespace proj4converter
+{
+
+
+// Moves expressions in forward and inverse bodies which only depend on
+// members of par and proj_parm into new members of proj_parm, calculated
+// at the end of each setup. This is done conservatively:
+// - expressions consist of numbers, constants, double members and calls
+//   of pure functions which do not throw
+// - members of proj_parm are assigned unconditionally in each setup, so the
+//   precomputed value is always defined, also if it is not used
+// - only expressions which are evaluated as a whole are moved, in the same
+//   order, such that the results are the same (e.g. not "b * c" of "a * b * c")
+class invariant_precomputer
+{
+public :
+    invariant_precomputer(projection_properties& prop)
+        : m_prop(prop)
+    {
+        // Functions throwing for invalid input are not moved to the setup
+        m_pure = pure_functions();
+        BOOST_FOREACH(std::string const& function, throwing_functions())
+        {
+            m_pure.erase(function);
+        }
+
+        char const* par[] = { "a", "e", "es", "ra", "one_es", "rone_es",
+            "lam0", "phi0", "x0", "y0", "k0", "to_meter", "fr_meter" };
+        m_par_members.insert(par, par + sizeof(par) / sizeof(par[0]));
+
+        BOOST_FOREACH(macro_or_const const& con, m_prop.defined_consts)
+        {
+            m_constants.insert(con.name);
+        }
+    }
+
+    // Returns the number of precomputed expressions
+    int apply()
+    {
+        // Projections without parameter struct would need another setup signature,
+        // projections with a setup returning a value might return early
+        if (m_prop.proj_parameters.empty()
+            || ! m_prop.setup_return_type.empty()
+            || m_prop.derived_projections.empty()
+            || ! collect_members())
+        {
+            return 0;
+        }
+
+        BOOST_FOREACH(projection& proj, m_prop.projections)
+        {
+            replace(proj.lines);
+        }
+
+        if (m_fields.empty())
+        {
+            return 0;
+        }
+
+        m_prop.proj_parameters.push_back("// precomputed in setup");
+        for (std::size_t i = 0; i < m_fields.size(); i++)
+        {
+            m_prop.proj_parameters.push_back("double " + m_fields[i].first + "; // "
+                + m_fields[i].second);
+        }
+        BOOST_FOREACH(derived& der, m_prop.derived_projections)
+        {
+            for (std::size_t i = 0; i < m_fields.size(); i++)
+            {
+                der.constructor_lines.push_back(tab1 + "proj_parm." + m_fields[i].first
+                    + " = " + m_fields[i].second + ";");
+            }
+        }
+        return static_cast<int>(m_fields.size());
+    }
+
+private :
+
+    struct token
+    {
+        enum kind_type { number, name, open, close, operation };
+        kind_type kind;
+        std::string text;
+        std::string::size_type begin, end;
+        std::size_t match; // index of matching parenthesis or bracket
+        bool invariant;
+        bool member;
+    };
+
+    struct unit
+    {
+        std::size_t begin, end; // token indices
+        bool invariant, member, work;
+        std::vector<std::pair<std::size_t, std::size_t> > inner;
+    };
+
+    struct segment
+    {
+        std::size_t sign;
+        bool left_strong, well_formed;
+        std::vector<unit> units;
+        std::vector<std::string> operations;
+
+        explicit segment(bool left)
+            : sign(std::string::npos)
+            , left_strong(left)
+            , well_formed(true)
+        {}
+    };
+
+    typedef std::pair<std::size_t, std::size_t> range;
+
+    // Collects the double members of proj_parm which are assigned in all setups
+    bool collect_members()
+    {
+        std::set<std::string> doubles;
+        BOOST_FOREACH(std::string const& line, m_prop.proj_parameters)
+        {
+            std::string code = line;
+            strip_comments(code);
+            boost::trim(code);
+            if (boost::starts_with(code, "double ")
+                && code.find_first_of("*[(") == std::string::npos)
+            {
+                std::vector<std::string> names;
+                split(code.substr(7), names, " ,;\t");
+                doubles.insert(names.begin(), names.end());
+            }
+        }
+
+        std::set<std::string> in_setup;
+        bool setup_called = false;
+        collect_unconditional(m_prop.setup_functions, 0, in_setup, setup_called);
+
+        bool first = true;
+        BOOST_FOREACH(derived const& der, m_prop.derived_projections)
+        {
+            BOOST_FOREACH(std::string const& line, der.constructor_lines)
+            {
+                if (contains_name(line, "return"))
+                {
+                    return false;
+                }
+            }
+            std::set<std::string> assigned;
+            bool calls_setup = false;
+            collect_unconditional(der.constructor_lines, 0, assigned, calls_setup);
+            if (calls_setup)
+            {
+                assigned.insert(in_setup.begin(), in_setup.end());
+            }
+
+            std::set<std::string> result;
+            BOOST_FOREACH(std::string const& name, assigned)
+            {
+                if (doubles.count(name) > 0 && (first || m_proj_members.count(name) > 0))
+                {
+                    result.insert(name);
+                }
+            }
+            m_proj_members = result;
+            first = false;
+        }
+
+        m_existing = extract_names(m_prop.proj_parameters);
+        return true;
+    }
+
+    // Collects the members of proj_parm which are always assigned, at the
+    // given depth of braces, and not after a return or a condition without braces
+    static void collect_unconditional(std::vector<std::string> const& lines,
+                int base_depth, std::set<std::string>& assigned, bool& calls_setup)
+    {
+        int depth = 0;
+        bool conditional = false;
+        bool returned = false;
+        BOOST_FOREACH(std::string const& line, lines)
+        {
+            std::string code = line;
+            strip_comments(code);
+            boost::trim(code);
+            if (code.empty() || code[0] == '#')
+            {
+                continue;
+            }
+
+            if (depth == base_depth && ! conditional && ! returned)
+            {
+                if (boost::starts_with(code, "proj_parm."))
+                {
+                    std::string::size_type j = 10;
+                    std::string name;
+                    while (j < code.size() && is_name_char(code[j]))
+                    {
+                        name += code[j++];
+                    }
+                    while (j < code.size() && code[j] == ' ')
+                    {
+                        j++;
+                    }
+                    if (code.compare(j, 1, "=") == 0 && code.compare(j, 2, "==") != 0)
+                    {
+                        assigned.insert(name);
+                    }
+                }
+                else if (boost::starts_with(code, "setup"))
+                {
+                    calls_setup = true;
+                }
+            }
+
+            if (depth >= base_depth && contains_name(code, "return"))
+            {
+                returned = true;
+            }
+            for (std::string::size_type j = 0; j < code.size(); j++)
+            {
+                if (code[j] == '{')
+                {
+                    depth++;
+                }
+                else if (code[j] == '}' && --depth < base_depth)
+                {
+                    // End of function, a next function might follow
+                    returned = false;
+                }
+            }
+            conditional = std::string(";{}").find(code[code.size() - 1]) == std::string::npos;
+        }
+    }
+
+    std::vector<token> tokenize(std::string const& code) const
+    {
+        std::vector<token> tokens;
+        std::vector<std::size_t> stack;
+        std::string::size_type j = 0;
+        while (j < code.size())
+        {
+            char const c = code[j];
+            if (std::isspace(c))
+            {
+                j++;
+                continue;
+            }
+
+            token t;
+            t.begin = j;
+            t.match = std::string::npos;
+            t.invariant = false;
+            t.member = false;
+            if (std::isdigit(c) || (c == '.' && j + 1 < code.size() && std::isdigit(code[j + 1])))
+            {
+                t.kind = token::number;
+                t.invariant = true;
+                while (j < code.size()
+                    && (is_name_char(code[j]) || code[j] == '.'
+                        || ((code[j] == '+' || code[j] == '-')
+                            && (code[j - 1] == 'e' || code[j - 1] == 'E'))))
+                {
+                    j++;
+                }
+            }
+            else if (is_name_char(c))
+            {
+                // Names including qualifications and member access
+                t.kind = token::name;
+                while (j < code.size())
+                {
+                    if (is_name_char(code[j]) || code.compare(j, 2, "::") == 0)
+                    {
+                        j += code[j] == ':' ? 2 : 1;
+                    }
+                    else if ((code[j] == '.' && j + 1 < code.size() && is_name_char(code[j + 1]))
+                        || (code.compare(j, 2, "->") == 0 && j + 2 < code.size() && is_name_char(code[j + 2])))
+                    {
+                        j += code[j] == '.' ? 1 : 2;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                // Constants as geometry::math::half_pi<double>()
+                if (code.compare(j, 10, "<double>()") == 0)
+                {
+                    j += 10;
+                    t.invariant = true;
+                }
+            }
+            else
+            {
+                t.kind = c == '(' || c == '[' ? token::open
+                    : c == ')' || c == ']' ? token::close
+                    : token::operation;
+                char const* two[] = { "==", "!=", "<=", ">=", "&&", "||", "+=", "-=",
+                    "*=", "/=", "<<", ">>", "++", "--", "->", "::" };
+                j++;
+                for (std::size_t k = 0; k < sizeof(two) / sizeof(two[0]); k++)
+                {
+                    if (code.compare(j - 1, 2, two[k]) == 0)
+                    {
+                        j++;
+                        break;
+                    }
+                }
+            }
+            t.end = j;
+            t.text = code.substr(t.begin, t.end - t.begin);
+
+            if (t.kind == token::name && ! t.invariant)
+            {
+                std::string const par = "this->m_par.";
+                std::string const proj_parm = "this->m_proj_parm.";
+                t.member = (boost::starts_with(t.text, par)
+                        && m_par_members.count(t.text.substr(par.size())) > 0)
+                    || (boost::starts_with(t.text, proj_parm)
+                        && m_proj_members.count(t.text.substr(proj_parm.size())) > 0);
+                t.invariant = t.member || m_constants.count(t.text) > 0;
+            }
+
+            if (t.kind == token::open)
+            {
+                stack.push_back(tokens.size());
+            }
+            else if (t.kind == token::close && ! stack.empty())
+            {
+                std::size_t const open = stack.back();
+                stack.pop_back();
+                if ((tokens[open].text == "(") == (t.text == ")"))
+                {
+                    tokens[open].match = tokens.size();
+                    t.match = open;
+                }
+            }
+            tokens.push_back(t);
+        }
+        return tokens;
+    }
+
+    static bool is_arithmetic(token const& t)
+    {
+        return t.kind == token::operation
+            && (t.text == "+" || t.text == "-" || t.text == "*" || t.text == "/");
+    }
+
+    static bool is_open(std::vector<token> const& tokens, std::size_t i, std::size_t e)
+    {
+        return tokens[i].kind == token::open
+            && tokens[i].match != std::string::npos
+            && tokens[i].match < e;
+    }
+
+    // Parses a number, name, call or parenthesized expression, with indices
+    unit parse_unit(std::vector<token> const& tokens, std::size_t i, std::size_t e) const
+    {
+        unit u;
+        u.begin = i;
+        u.invariant = false;
+        u.member = false;
+        u.work = false;
+
+        token const& t = tokens[i];
+        if (t.kind == token::name && i + 1 < e && tokens[i + 1].text == "(" && is_open(tokens, i + 1, e))
+        {
+            std::size_t const close = tokens[i + 1].match;
+            u.end = close + 1;
+            u.work = true;
+            u.inner.push_back(range(i + 2, close));
+
+            bool invariant = m_pure.count(t.text) > 0 && close > i + 2;
+            std::size_t arg = i + 2;
+            for (std::size_t k = i + 2; invariant && k <= close; k++)
+            {
+                if (k == close || tokens[k].text == ",")
+                {
+                    bool work = false;
+                    invariant = invariant_expression(tokens, arg, k, u.member, work);
+                    arg = k + 1;
+                }
+                else if (is_open(tokens, k, close))
+                {
+                    k = tokens[k].match;
+                }
+            }
+            u.invariant = invariant;
+        }
+        else if (t.text == "(" && is_open(tokens, i, e))
+        {
+            std::size_t const close = t.match;
+            u.end = close + 1;
+            u.inner.push_back(range(i + 1, close));
+            // Not after a cast as static_cast<int>
+            u.invariant = (i == 0 || tokens[i - 1].text != ">")
+                && invariant_expression(tokens, i + 1, close, u.member, u.work);
+        }
+        else
+        {
+            u.end = i + 1;
+            u.invariant = t.invariant;
+            u.member = t.member;
+        }
+
+        // Indexing
+        while (u.end < e && tokens[u.end].text == "[" && is_open(tokens, u.end, e))
+        {
+            u.inner.push_back(range(u.end + 1, tokens[u.end].match));
+            u.end = tokens[u.end].match + 1;
+            u.invariant = false;
+        }
+        return u;
+    }
+
+    // Returns true if the range is an arithmetic expression of invariant units
+    bool invariant_expression(std::vector<token> const& tokens, std::size_t b, std::size_t e,
+                bool& member, bool& work) const
+    {
+        std::size_t i = b;
+        if (i < e && (tokens[i].text == "+" || tokens[i].text == "-"))
+        {
+            i++;
+        }
+        while (i < e)
+        {
+            unit const u = parse_unit(tokens, i, e);
+            if (! u.invariant)
+            {
+                return false;
+            }
+            member = member || u.member;
+            work = work || u.work;
+            i = u.end;
+            if (i == e)
+            {
+                return true;
+            }
+            if (! is_arithmetic(tokens[i]))
+            {
+                return false;
+            }
+            work = true;
+            i++;
+        }
+        return false;
+    }
+
+    static bool is_separator(token const& t)
+    {
+        return (t.kind == token::operation && ! is_arithmetic(t))
+            || (t.kind == token::name
+                && (t.text == "return" || t.text == "case" || t.text == "else" || t.text == "do"));
+    }
+
+    // Finds the invariant expressions in the range, which are bounded by
+    // separators or by the start or end of the line (strong) or not (weak)
+    void scan(std::vector<token> const& tokens, std::size_t b, std::size_t e,
+            bool left_strong, bool right_strong, std::vector<range>& candidates) const
+    {
+        segment seg(left_strong);
+        bool expect_unit = true;
+        std::size_t i = b;
+        while (i < e)
+        {
+            token const& t = tokens[i];
+            bool const unmatched = t.kind == token::close
+                || (t.kind == token::open && ! is_open(tokens, i, e));
+            if (unmatched || is_separator(t))
+            {
+                finish(seg, ! unmatched, candidates);
+                seg = segment(! unmatched);
+                expect_unit = true;
+                i++;
+                continue;
+            }
+            if (t.kind == token::operation)
+            {
+                if (! expect_unit)
+                {
+                    seg.operations.push_back(t.text);
+                }
+                else if ((t.text == "+" || t.text == "-") && seg.units.empty()
+                    && seg.sign == std::string::npos)
+                {
+                    seg.sign = i;
+                }
+                else
+                {
+                    seg.well_formed = false;
+                }
+                expect_unit = true;
+                i++;
+                continue;
+            }
+
+            unit const u = parse_unit(tokens, i, e);
+            if (! u.invariant)
+            {
+                for (std::size_t k = 0; k < u.inner.size(); k++)
+                {
+                    scan(tokens, u.inner[k].first, u.inner[k].second, true, true, candidates);
+                }
+            }
+            if (! expect_unit)
+            {
+                seg.well_formed = false;
+            }
+            seg.units.push_back(u);
+            expect_unit = false;
+            i = u.end;
+        }
+        finish(seg, right_strong, candidates);
+    }
+
+    static void add(std::vector<range>& candidates, unit const& first, unit const& last)
+    {
+        candidates.push_back(range(first.begin, last.end));
+    }
+
+    static void add_if_compound(std::vector<range>& candidates, unit const& u)
+    {
+        // Calls and parenthesized expressions can be replaced on their own
+        if (u.invariant && u.member && u.work)
+        {
+            add(candidates, u, u);
+        }
+    }
+
+    // Returns true if the units [b, e) are invariant, and whether they contain
+    // a member and something to calculate
+    static bool invariant_units(segment const& seg, std::size_t b, std::size_t e,
+                bool& member, bool& work)
+    {
+        member = false;
+        work = e - b > 1;
+        for (std::size_t k = b; k < e; k++)
+        {
+            if (! seg.units[k].invariant)
+            {
+                return false;
+            }
+            member = member || seg.units[k].member;
+            work = work || seg.units[k].work;
+        }
+        return true;
+    }
+
+    static void finish(segment const& seg, bool right_strong, std::vector<range>& candidates)
+    {
+        std::size_t const n = seg.units.size();
+        if (n == 0)
+        {
+            return;
+        }
+
+        bool member = false, work = false;
+        if (! seg.well_formed || seg.operations.size() + 1 != n)
+        {
+            BOOST_FOREACH(unit const& u, seg.units)
+            {
+                add_if_compound(candidates, u);
+            }
+            return;
+        }
+
+        // The whole segment
+        if (seg.left_strong && right_strong
+            && invariant_units(seg, 0, n, member, work) && member && work)
+        {
+            candidates.push_back(range(seg.sign != std::string::npos ? seg.sign
+                : seg.units.front().begin, seg.units.back().end));
+            return;
+        }
+
+        // Split into terms, separated by + or -
+        std::vector<range> terms;
+        std::size_t start = 0;
+        for (std::size_t k = 0; k < seg.operations.size(); k++)
+        {
+            if (seg.operations[k] == "+" || seg.operations[k] == "-")
+            {
+                terms.push_back(range(start, k + 1));
+                start = k + 1;
+            }
+        }
+        terms.push_back(range(start, n));
+
+        // Invariant terms at the start, e.g. "a + b" of "a + b + x"
+        std::size_t t = 0;
+        if (seg.left_strong)
+        {
+            bool prefix_member = false;
+            while (t < terms.size()
+                && invariant_units(seg, terms[t].first, terms[t].second, member, work))
+            {
+                prefix_member = prefix_member || member;
+                t++;
+            }
+            if (t == terms.size() && ! right_strong)
+            {
+                // The next line might continue with a multiplication
+                t--;
+            }
+            if (t >= 2 && prefix_member)
+            {
+                candidates.push_back(range(seg.sign != std::string::npos ? seg.sign
+                    : seg.units.front().begin, seg.units[terms[t - 1].second - 1].end));
+            }
+            else
+            {
+                t = 0;
+            }
+        }
+
+        for (; t < terms.size(); t++)
+        {
+            std::size_t const b = terms[t].first;
+            std::size_t const e = terms[t].second;
+            // Invariant factors at the start, e.g. "a * b" of "a * b * x"
+            std::size_t p = b;
+            bool prefix_member = false, prefix_work = false;
+            while (p < e && seg.units[p].invariant)
+            {
+                prefix_member = prefix_member || seg.units[p].member;
+                prefix_work = prefix_work || seg.units[p].work;
+                p++;
+            }
+            bool const strong = t > 0 || seg.left_strong;
+            std::size_t k = b;
+            if (strong && prefix_member && (p - b > 1 || prefix_work))
+            {
+                add(candidates, seg.units[b], seg.units[p - 1]);
+                k = p;
+            }
+            for (; k < e; k++)
+            {
+                add_if_compound(candidates, seg.units[k]);
+            }
+        }
+    }
+
+    static bool complete(std::string const& code)
+    {
+        std::string const trimmed = boost::trim_copy(code);
+        return trimmed.empty()
+            || trimmed[0] == '#'
+            || std::string(";{}:").find(trimmed[trimmed.size() - 1]) != std::string::npos;
+    }
+
+    std::string field_name(std::vector<token> const& tokens, range const& r)
+    {
+        std::string base = "pre";
+        for (std::size_t k = r.first; k < r.second; k++)
+        {
+            token const& t = tokens[k];
+            if (t.member || (t.kind == token::name && m_pure.count(t.text) > 0))
+            {
+                std::string::size_type const pos = t.text.find_last_of(".:");
+                base += "_" + (pos == std::string::npos ? t.text : t.text.substr(pos + 1));
+            }
+        }
+
+        std::string name = base;
+        for (int n = 2; std::find(m_existing.begin(), m_existing.end(), name) != m_existing.end(); n++)
+        {
+            name = base + "_" + boost::lexical_cast<std::string>(n);
+        }
+        m_existing.push_back(name);
+        return name;
+    }
+
+    void replace(std::vector<std::string>& lines)
+    {
+        std::vector<std::string> const code = blank_comments(lines);
+        for (std::size_t i = 0; i < code.size(); i++)
+        {
+            if (boost::starts_with(boost::trim_copy(code[i]), "#"))
+            {
+                continue;
+            }
+
+            std::vector<token> const tokens = tokenize(code[i]);
+            bool left_strong = true;
+            for (std::size_t k = i; k > 0; k--)
+            {
+                if (! boost::trim_copy(code[k - 1]).empty())
+                {
+                    left_strong = complete(code[k - 1]);
+                    break;
+                }
+            }
+
+            std::vector<range> candidates;
+            scan(tokens, 0, tokens.size(), left_strong, complete(code[i]), candidates);
+
+            // Replace from the back, such that positions stay valid
+            for (std::size_t k = candidates.size(); k > 0; k--)
+            {
+                range const& r = candidates[k - 1];
+                std::string::size_type const begin = tokens[r.first].begin;
+                std::string::size_type const length = tokens[r.second - 1].end - begin;
+
+                // Without the parentheses, which are then not necessary anymore
+                range inner = r;
+                if (tokens[r.first].text == "(" && tokens[r.first].match == r.second - 1)
+                {
+                    inner = range(r.first + 1, r.second - 1);
+                }
+                std::string const expression = code[i].substr(tokens[inner.first].begin,
+                    tokens[inner.second - 1].end - tokens[inner.first].begin);
+
+                std::string const key = boost::erase_all_copy(expression, " ");
+                std::map<std::string, std::string>::const_iterator it = m_names.find(key);
+                std::string name;
+                if (it == m_names.end())
+                {
+                    name = field_name(tokens, inner);
+                    m_names[key] = name;
+                    std::string setup_expression = expression;
+                    boost::replace_all(setup_expression, "this->m_par.", "par.");
+                    boost::replace_all(setup_expression, "this->m_proj_parm.", "proj_parm.");
+                    m_fields.push_back(std::make_pair(name, setup_expression));
+                }
+                else
+                {
+                    name = it->second;
+                }
+                lines[i].replace(begin, length, "this->m_proj_parm." + name);
+                m_prop.report["precomputed " + expression]++;
+            }
+        }
+    }
+
+    projection_properties& m_prop;
+
+    std::set<std::string> m_pure;
+    std::set<std::string> m_par_members;
+    std::set<std::string> m_proj_members;
+    std::set<std::string> m_constants;
+    std::vector<std::string> m_existing;
+
+    // Expression without spaces -> name of member
+    std::map<std::string, std::string> m_names;
+    // Name of member, expression for setup
+    std::vector<std::pair<std::string, std::string> > m_fields;
+};
+
+
+}}} // namespace boost::geometry::proj4converter
+
+
+#endif // TISSOT_PRECOMPUTE_HPP
@@ -11,6 +11,7 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <deque>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -27,10 +28,12 @@ struct epsg_entry
     int epsg_code;
     std::string prj_name;
     std::string parameters;
-    epsg_entry(int code, std::string const& name, std::string const& pars)
+    bool traits; // specialized as epsg_traits
+    epsg_entry(int code, std::string const& name, std::string const& pars, bool tr)
         : epsg_code(code)
         , prj_name(name)
         , parameters(pars)
+        , traits(tr)
     {}
 };
 
@@ -45,6 +48,14 @@ struct projection
     std::vector<std::string> preceding_lines;
     std::deque<std::string> trailing_lines;
 
+    // For forward: "separable" (x depends on the longitude only, y on the
+    // latitude only) or "rows" (part depends on the latitude only), and the
+    // lines split into declarations, statements per row and per point
+    std::string grid;
+    std::vector<std::string> row_declarations;
+    std::vector<std::string> row_lines;
+    std::vector<std::string> point_lines;
+
     // Sort on subgroup, then on model, then on direction
     inline bool operator<(projection const& other) const
     {
@@ -111,8 +122,14 @@ struct projection_properties
     bool has_ellipsoid;
     bool has_spheroid;
     bool has_guam;
+    std::set<std::string> options; // from the command line, without "--"
+    std::map<std::string, int> report; // counts of optimizations, per pass
+    std::set<std::string> double_calculations; // functions the float kernels call in double
     std::string forward_declarations;
     std::string template_struct;
+    // for projections forwarding to another projection (ob_tran):
+    // default type of the Link template parameter
+    std::string link_type;
     std::string setup_return_type; // If empty, then "void" assumed
     std::string setup_extra_parameters;
     std::vector<std::string> first_comments;
@@ -122,6 +139,13 @@ struct projection_properties
     std::set<std::string> extra_impl_includes;
     std::set<std::string> extra_proj_includes;
 
+    // ellipsoid dependent tables (en/apa/mdist) shared between projections
+    std::set<std::string> shared_tables;
+
+    // values (N_POLE, S_POLE, ...) of the mode, if forward/inverse can be
+    // specialized for it at compile time
+    std::vector<std::string> mode_values;
+
     std::vector<std::string> extra_member_initialization_list;
     std::vector<std::string> extra_structs;
 
@@ -10,7 +10,9 @@
 // Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <cctype>
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -19,6 +21,7 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <boost/lexical_cast.hpp>
 #include <boost/tokenizer.hpp>
 
 namespace boost { namespace geometry { namespace proj4converter
@@ -70,6 +73,43 @@ inline void split(std::string const& line, std::vector<std::string>& subs, std::
     }
 }
 
+// Returns true if a proj4 definition has a +name or +name=value parameter,
+// and assigns its value (empty for flags)
+inline bool definition_parameter(std::string const& definition, std::string const& name, std::string& value)
+{
+    std::vector<std::string> parameters;
+    split(definition, parameters, " ");
+    for (std::vector<std::string>::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+    {
+        std::string::size_type const pos = it->find('=');
+        if (it->substr(0, pos) == "+" + name)
+        {
+            value = pos == std::string::npos ? "" : it->substr(pos + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the value of a +name=value parameter, if it is a number
+inline bool parameter_value(std::string const& definition, std::string const& name, double& value)
+{
+    std::string s;
+    if (! definition_parameter(definition, name, s))
+    {
+        return false;
+    }
+    try
+    {
+        value = boost::lexical_cast<double>(s);
+        return true;
+    }
+    catch (boost::bad_lexical_cast const&)
+    {
+    }
+    return false;
+}
+
 inline std::vector<std::string> extract_names(std::vector<std::string> const& parameters)
 {
     std::string pars;
@@ -98,6 +138,310 @@ inline std::vector<std::string> extract_names(std::vector<std::string> const& pa
     return retval;
 }
 
+// Returns the names of the functions called in a line (e.g. sin, pj_param),
+// without keywords followed by a parenthesis
+inline std::set<std::string> called_functions(std::string const& line)
+{
+    std::set<std::string> result;
+    std::string name;
+    for (std::string::size_type i = 0; i <= line.size(); i++)
+    {
+        char const ch = i < line.size() ? line[i] : ' ';
+        if (std::isalnum(ch) || ch == '_' || ch == ':')
+        {
+            name += ch;
+            continue;
+        }
+        if (! name.empty() && ! std::isdigit(name[0]))
+        {
+            std::string::size_type next = line.find_first_not_of(" \t", i);
+            if (next != std::string::npos && line[next] == '('
+                && name != "if" && name != "while" && name != "for"
+                && name != "switch" && name != "return" && name != "sizeof")
+            {
+                result.insert(name);
+            }
+        }
+        name.clear();
+    }
+    return result;
+}
+
+// Returns true if the expression only consists of literals, operators
+// and known (constant) names, such that it can be evaluated at compile time
+inline bool is_constant_expression(std::string const& expression,
+            std::set<std::string> const& known_names)
+{
+    if (boost::starts_with(expression, "\"") && boost::ends_with(expression, "\""))
+    {
+        return true;
+    }
+
+    std::string name;
+    for (std::string::size_type i = 0; i <= expression.size(); i++)
+    {
+        char const ch = i < expression.size() ? expression[i] : ' ';
+        if (std::isalnum(ch) || ch == '_' || ch == '.')
+        {
+            name += ch;
+            continue;
+        }
+        if (! name.empty())
+        {
+            // Numbers (including exponents, e.g. 1e-10 or 1.e-10) are allowed,
+            // names only if they are known
+            bool const numeric = std::isdigit(name[0]) || name[0] == '.';
+            if (! numeric && known_names.count(name) == 0)
+            {
+                return false;
+            }
+            name.clear();
+        }
+        if (! (std::isspace(ch) || ch == '+' || ch == '-' || ch == '*'
+               || ch == '/' || ch == '(' || ch == ')'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the string is a valid C/C++ identifier
+inline bool is_name(std::string const& s)
+{
+    if (s.empty() || std::isdigit(s[0]))
+    {
+        return false;
+    }
+    for (std::string::size_type i = 0; i < s.size(); i++)
+    {
+        if (! (std::isalnum(s[i]) || s[i] == '_'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the position of name as a complete identifier in the expression
+// (it might be preceded by a dot, e.g. in "this->m_proj_parm"), or npos
+inline std::string::size_type find_name(std::string const& expression,
+            std::string const& name, std::string::size_type start = 0)
+{
+    std::string::size_type loc = expression.find(name, start);
+    while (loc != std::string::npos)
+    {
+        std::string::size_type const end = loc + name.size();
+        bool const begins = loc == 0
+            || ! (std::isalnum(expression[loc - 1]) || expression[loc - 1] == '_');
+        bool const ends = end == expression.size()
+            || ! (std::isalnum(expression[end]) || expression[end] == '_');
+        if (begins && ends)
+        {
+            return loc;
+        }
+        loc = expression.find(name, loc + 1);
+    }
+    return std::string::npos;
+}
+
+// Returns true if the expression contains name as a complete identifier
+inline bool contains_name(std::string const& expression, std::string const& name)
+{
+    return find_name(expression, name) != std::string::npos;
+}
+
+inline bool is_name_char(char c)
+{
+    return std::isalnum(c) || c == '_';
+}
+
+// Returns the functions without side effects, which the passes on forward and
+// inverse may evaluate once instead of each time, or in another order.
+// Some of them throw for invalid input (see throwing_functions)
+inline std::set<std::string> pure_functions()
+{
+    char const* pure[] = { "sin", "cos", "tan", "asin", "acos", "atan",
+        "atan2", "sinh", "cosh", "tanh", "exp", "log", "log10", "sqrt",
+        "fabs", "pow", "floor", "ceil", "hypot", "boost::math::hypot",
+        "aasin", "aacos", "aatan2", "asqrt", "adjlon", "int_floor",
+        "pj_tsfn", "pj_msfn", "pj_qsfn", "pj_mlfn", "pj_phi2",
+        "CalculationType" };
+    return std::set<std::string>(pure, pure + sizeof(pure) / sizeof(pure[0]));
+}
+
+// Returns the pure functions which throw for invalid input (aasin/aacos
+// outside [-1,1], pj_phi2 if it does not converge)
+inline std::set<std::string> throwing_functions()
+{
+    char const* throwing[] = { "aasin", "aacos", "pj_phi2" };
+    return std::set<std::string>(throwing, throwing + sizeof(throwing) / sizeof(throwing[0]));
+}
+
+// Returns the name at pos, skipping spaces, dereferences and parentheses
+inline std::string name_at(std::string const& code, std::string::size_type pos)
+{
+    while (pos < code.size() && (code[pos] == ' ' || code[pos] == '*' || code[pos] == '('))
+    {
+        pos++;
+    }
+    std::string name;
+    while (pos < code.size() && is_name_char(code[pos]))
+    {
+        name += code[pos++];
+    }
+    return name;
+}
+
+// Returns the first name of the chain (e.g. "a" in "a.b->c[i]") ending before end
+inline std::string lvalue_root(std::string const& code, std::string::size_type end)
+{
+    std::string::size_type j = end;
+    while (j > 0 && code[j - 1] == ' ')
+    {
+        j--;
+    }
+    std::string::size_type begin = j;
+    while (begin > 0
+        && (is_name_char(code[begin - 1]) || code[begin - 1] == '.'
+            || code[begin - 1] == ']' || code[begin - 1] == '['
+            || (code[begin - 1] == '>' && begin > 1 && code[begin - 2] == '-')
+            || (code[begin - 1] == '-' && begin < code.size() && code[begin] == '>')))
+    {
+        begin--;
+    }
+    return name_at(code, begin);
+}
+
+// Returns the (possibly qualified) function name before the parenthesis,
+// or an empty string if there is none or it is a statement (e.g. "if")
+inline std::string function_before(std::string const& code, std::string::size_type open)
+{
+    std::string::size_type begin = open;
+    while (begin > 0 && code[begin - 1] == ' ')
+    {
+        begin--;
+    }
+    std::string::size_type const end = begin;
+    while (begin > 0 && (is_name_char(code[begin - 1]) || code[begin - 1] == ':'))
+    {
+        begin--;
+    }
+    std::string const name = code.substr(begin, end - begin);
+    bool const statement = name == "if" || name == "while" || name == "for"
+        || name == "switch" || name == "return";
+    return name.empty() || std::isdigit(name[0]) || statement ? "" : name;
+}
+
+// Returns the position of the parenthesis closing the one at open, or npos
+inline std::string::size_type closing(std::string const& code, std::string::size_type open)
+{
+    int depth = 0;
+    for (std::string::size_type j = open; j < code.size(); j++)
+    {
+        if (code[j] == '(')
+        {
+            depth++;
+        }
+        else if (code[j] == ')' && --depth == 0)
+        {
+            return j;
+        }
+    }
+    return std::string::npos;
+}
+
+// Returns all names, skipping members (after . or ->), numbers (including
+// exponents, 1.e-10), functions, and this (of which the members cannot be
+// changed in fwd/inv, which are const)
+inline std::vector<std::string> names_in(std::string const& expression)
+{
+    std::vector<std::string> result;
+    std::string::size_type j = 0;
+    while (j < expression.size())
+    {
+        if (! is_name_char(expression[j]) || std::isdigit(expression[j]))
+        {
+            bool const member = (expression[j] == '.' && j > 0 && is_name_char(expression[j - 1]))
+                || expression.compare(j, 2, "->") == 0;
+            bool const number = std::isdigit(expression[j]) || expression[j] == '.';
+            j += expression.compare(j, 2, "->") == 0 ? 2 : 1;
+            if (member || number)
+            {
+                while (j < expression.size()
+                    && (is_name_char(expression[j]) || (number && ! member && expression[j] == '.')))
+                {
+                    j++;
+                }
+            }
+            continue;
+        }
+        std::string name;
+        while (j < expression.size() && (is_name_char(expression[j]) || expression[j] == ':'))
+        {
+            name += expression[j++];
+        }
+        std::string::size_type k = j;
+        while (k < expression.size() && expression[k] == ' ')
+        {
+            k++;
+        }
+        if ((k >= expression.size() || expression[k] != '(') && name != "this")
+        {
+            result.push_back(name);
+        }
+    }
+    return result;
+}
+
+// Returns the lines with comments replaced by spaces, such that positions
+// in the code correspond with positions in the original lines
+inline std::vector<std::string> blank_comments(std::vector<std::string> const& lines)
+{
+    std::vector<std::string> result;
+    bool in_comment = false;
+    for (std::size_t i = 0; i < lines.size(); i++)
+    {
+        std::string const& line = lines[i];
+        std::string code;
+        std::string::size_type j = 0;
+        while (j < line.size())
+        {
+            if (in_comment)
+            {
+                if (line.compare(j, 2, "*/") == 0)
+                {
+                    in_comment = false;
+                    code += "  ";
+                    j += 2;
+                }
+                else
+                {
+                    code += ' ';
+                    j++;
+                }
+            }
+            else if (line.compare(j, 2, "/*") == 0)
+            {
+                in_comment = true;
+                code += "  ";
+                j += 2;
+            }
+            else if (line.compare(j, 2, "//") == 0)
+            {
+                code += std::string(line.size() - j, ' ');
+                j = line.size();
+            }
+            else
+            {
+                code += line[j++];
+            }
+        }
+        result.push_back(code);
+    }
+    return result;
+}
+
 inline std::string end_entry(std::string const& line)
 {
     // Process it
@@ -173,6 +517,11 @@ struct functor_trimmed_equals
         tokens.push_back(line1);
         tokens.push_back(line2);
     }
+    functor_trimmed_equals& add(std::string const& s)
+    {
+        tokens.push_back(s);
+        return *this;
+    }
 
     inline bool operator()(std::string const& line) const
     {